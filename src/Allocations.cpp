@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <new>
+
+#include "Counters.h"
+
+// Counts heap allocations for the frame counters. Only linked into the game, the tools keep the
+// default allocator. Every form of new is replaced, array, nothrow and aligned ones included, so
+// nothing slips past the count.
+
+static void *allocate(std::size_t size)
+{
+	g_counters.add(Counter::Allocations);
+	g_counters.add(Counter::AllocatedBytes, size);
+	return std::malloc(size ? size : 1);
+}
+
+static void *allocate(std::size_t size, std::align_val_t align)
+{
+	g_counters.add(Counter::Allocations);
+	g_counters.add(Counter::AllocatedBytes, size);
+	auto const alignment = static_cast<std::size_t>(align);
+#if defined(_WIN32)
+	return _aligned_malloc(size ? size : 1, alignment);
+#else
+	// aligned_alloc() wants a non-zero multiple of the alignment.
+	return std::aligned_alloc(alignment, (size / alignment + 1) * alignment);
+#endif
+}
+
+static void release(void *ptr, std::align_val_t)
+{
+#if defined(_WIN32)
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+// Like the standard ones, give the new handler a chance to free memory before giving up.
+template <typename... Align>
+static void *allocate_or_throw(std::size_t size, Align... align)
+{
+	for (;;) {
+		if (void *ptr = allocate(size, align...))
+			return ptr;
+		auto const handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void *operator new(std::size_t size) { return allocate_or_throw(size); }
+void *operator new[](std::size_t size) { return allocate_or_throw(size); }
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept { return allocate(size); }
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept { return allocate(size); }
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+	return allocate_or_throw(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+	return allocate_or_throw(size, align);
+}
+void *operator new(std::size_t size, std::align_val_t align, std::nothrow_t const &) noexcept
+{
+	return allocate(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, std::nothrow_t const &) noexcept
+{
+	return allocate(size, align);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::nothrow_t const &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::nothrow_t const &) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete(void *ptr, std::size_t, std::align_val_t align) noexcept
+{
+	release(ptr, align);
+}
+void operator delete(void *ptr, std::align_val_t align, std::nothrow_t const &) noexcept
+{
+	release(ptr, align);
+}
+void operator delete[](void *ptr, std::align_val_t align) noexcept { release(ptr, align); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t align) noexcept
+{
+	release(ptr, align);
+}
+void operator delete[](void *ptr, std::align_val_t align, std::nothrow_t const &) noexcept
+{
+	release(ptr, align);
+}
@@ -0,0 +1,143 @@
+#include "AssetLoader.h"
+
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "GameState.h"
+#include "LevelCatalogue.h"
+
+constexpr auto SONGS = 6;
+constexpr auto FONT_SIZE = 60;
+constexpr auto FONT_GLYPHS = 95; // Printable ASCII, what LoadFontEx() picks without codepoints.
+constexpr auto FONT_PADDING = 4; // raylib's FONT_TTF_DEFAULT_CHARS_PADDING.
+
+// Workers stay away from TextFormat() and anything else raylib keeps static buffers for.
+static std::shared_ptr<std::vector<u8>> read_file(std::string const &path)
+{
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		throw std::runtime_error("Failed to open " + path + " for reading.");
+	return std::make_shared<std::vector<u8>>(
+	    std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+// The CPU half of LoadFontEx(): rasterised glyphs plus their atlas, which is left to upload.
+static std::pair<Font, Image> load_font_data(std::string const &path)
+{
+	auto const data = read_file(path);
+
+	Font font {};
+	font.baseSize = FONT_SIZE;
+	font.glyphCount = FONT_GLYPHS;
+	font.glyphs = LoadFontData(
+	    data->data(), data->size(), font.baseSize, nullptr, font.glyphCount, FONT_DEFAULT);
+	if (!font.glyphs)
+		throw std::runtime_error("Failed to load font " + path + ".");
+	font.glyphPadding = FONT_PADDING;
+
+	Image const atlas = GenImageFontAtlas(
+	    font.glyphs, &font.recs, font.glyphCount, font.baseSize, font.glyphPadding, 0);
+	for (int i = 0; i < font.glyphCount; i++) {
+		UnloadImage(font.glyphs[i].image);
+		font.glyphs[i].image = ImageFromImage(atlas, font.recs[i]);
+	}
+	return { font, atlas };
+}
+
+template <typename F>
+void AssetLoader::queue(ThreadPool &pool, bool menu, F &&job)
+{
+	m_pending.push_back({ pool.submit(std::forward<F>(job)), menu });
+	m_menu_pending += menu;
+}
+
+void AssetLoader::start(ThreadPool &pool, AudioCallback processor)
+{
+	// Menu essentials first so they are at the front of the queue.
+	this->queue(pool, true, [] {
+		auto levels = std::make_shared<LevelCatalogue>();
+		levels->scan(RESOURCES_PATH "levels");
+		return std::function<void()>([levels] {
+			levels->on_evict = std::move(g_gs.levels.on_evict);
+			g_gs.levels = std::move(*levels);
+		});
+	});
+	this->queue(pool, true, [] {
+		auto const font = load_font_data(RESOURCES_PATH "SpaceMono-Regular.ttf");
+		return std::function<void()>([font] {
+			g_gs.font = font.first;
+			g_gs.font.texture = LoadTextureFromImage(font.second);
+			UnloadImage(font.second);
+		});
+	});
+	auto const queue_texture = [&](Texture2D *texture, std::string path) {
+		this->queue(pool, true, [texture, path] {
+			Image const image = LoadImage(path.c_str());
+			return std::function<void()>([texture, image] {
+				*texture = LoadTextureFromImage(image);
+				UnloadImage(image);
+			});
+		});
+	};
+	queue_texture(&g_gs.spritesheet, RESOURCES_PATH "spritesheet.png");
+	queue_texture(&g_gs.settings_icon, RESOURCES_PATH "settings.png");
+	this->queue(pool, true, [] {
+		auto const data = read_file(RESOURCES_PATH "Dialog.json");
+		auto dialogs = std::make_shared<nlohmann::json>(nlohmann::json::parse(*data));
+		return std::function<void()>([dialogs] { g_gs.deserialize_dialogs(*dialogs); });
+	});
+
+	auto const queue_sound = [&](Sound *sound, std::string path) {
+		this->queue(pool, false, [sound, path] {
+			Wave const wave = LoadWave(path.c_str());
+			return std::function<void()>([sound, wave] {
+				*sound = LoadSoundFromWave(wave);
+				UnloadWave(wave);
+			});
+		});
+	};
+	queue_sound(&g_gs.explosion, RESOURCES_PATH "explosion.mp3");
+	queue_sound(&g_gs.pickup, RESOURCES_PATH "pickup.wav");
+	queue_sound(&g_gs.wall_hit, RESOURCES_PATH "wall_hit.wav");
+
+	// Streams decode from memory as they play, so the file contents are kept in `music_data`.
+	g_gs.music.assign(SONGS, Music {});
+	g_gs.music_data.resize(SONGS);
+	for (usize i = 0; i < SONGS; i++) {
+		this->queue(pool, false, [i, processor] {
+			auto data = read_file(RESOURCES_PATH "music_" + std::to_string(i) + ".mp3");
+			return std::function<void()>([i, processor, data] {
+				auto &bytes = g_gs.music_data[i] = std::move(*data);
+				auto &song = g_gs.music[i]
+				    = LoadMusicStreamFromMemory(".mp3", bytes.data(), bytes.size());
+				AttachAudioStreamProcessor(song.stream, processor);
+				if (i == g_gs.current_song)
+					PlayMusicStream(song);
+			});
+		});
+	}
+}
+
+void AssetLoader::poll(void)
+{
+	bool const menu_only = !this->menu_ready();
+	for (usize i = 0; i < m_pending.size();) {
+		auto &pending = m_pending[i];
+		if ((menu_only && !pending.menu)
+		    || pending.finish.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			i++;
+			continue;
+		}
+
+		pending.finish.get()();
+		m_menu_pending -= pending.menu;
+		bool const menu = pending.menu;
+		m_pending.erase(m_pending.begin() + i);
+		if (!menu_only && !menu)
+			break;
+	}
+}
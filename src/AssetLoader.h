@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <vector>
+
+#include <raylib.h>
+
+#include "ThreadPool.h"
+#include "common.h"
+
+// Startup asset loading. File reads, decoding and parsing run on the thread pool, each job
+// handing back a step that finishes it on the main thread, where raylib needs the GL and audio
+// device uploads to happen.
+struct AssetLoader {
+	// Queues every asset into `g_gs`. Music streams get `processor` attached.
+	void start(ThreadPool &pool, AudioCallback processor);
+
+	// Finishes jobs the workers are done with, call once per frame from the main thread. Until
+	// the menu is ready only its own assets are finished, after that the rest go one per call so
+	// no single frame stalls on them.
+	void poll(void);
+
+	// Everything the menu draws with is loaded.
+	bool menu_ready(void) const { return m_menu_pending == 0; }
+	bool done(void) const { return m_pending.empty(); }
+
+private:
+	struct Pending {
+		std::future<std::function<void()>> finish;
+		bool                               menu;
+	};
+
+	template <typename F>
+	void queue(ThreadPool &pool, bool menu, F &&job);
+
+	std::vector<Pending> m_pending;
+	usize                m_menu_pending = 0;
+};
@@ -0,0 +1,87 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+constexpr auto BVH_LEAF_SIZE = 4;
+
+void BVH::build(std::vector<AABB> const &bounds)
+{
+	m_nodes.clear();
+	m_bounds = bounds;
+	m_items.resize(bounds.size());
+	for (u32 i = 0; i < bounds.size(); i++)
+		m_items[i] = i;
+	if (bounds.empty())
+		return;
+
+	m_nodes.reserve(bounds.size() * 2);
+	m_nodes.push_back({});
+	build_node(0, bounds, 0, bounds.size());
+}
+
+void BVH::build_node(u32 node, std::vector<AABB> const &bounds, u32 first, u32 count)
+{
+	AABB box = bounds[m_items[first]];
+	for (u32 i = first; i < first + count; i++)
+		box = AABBUnion(box, bounds[m_items[i]]);
+	m_nodes[node].bounds = box;
+
+	if (count <= BVH_LEAF_SIZE) {
+		m_nodes[node].first = first;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	bool const split_x = box.max.x - box.min.x > box.max.y - box.min.y;
+	auto const centre = [&](u32 item) {
+		auto const &b = bounds[item];
+		return split_x ? b.min.x + b.max.x : b.min.y + b.max.y;
+	};
+	u32 const half = count / 2;
+	std::nth_element(m_items.begin() + first, m_items.begin() + first + half,
+	    m_items.begin() + first + count, [&](u32 a, u32 b) { return centre(a) < centre(b); });
+
+	u32 const left = m_nodes.size();
+	m_nodes.push_back({});
+	m_nodes.push_back({});
+	m_nodes[node].first = left;
+	m_nodes[node].count = 0;
+	build_node(left, bounds, first, half);
+	build_node(left + 1, bounds, first + half, count - half);
+}
+
+void BVH::query(AABB const &box, std::vector<u32> &out) const
+{
+	if (m_nodes.empty())
+		return;
+
+	usize const first = out.size();
+
+	u32 stack[BVH_MAX_DEPTH];
+	u32 top = 0;
+	stack[top++] = 0;
+	while (top) {
+		auto const &node = m_nodes[stack[--top]];
+		if (!CheckCollisionAABBs(node.bounds, box))
+			continue;
+
+		if (node.count) {
+			for (u32 i = node.first; i < node.first + node.count; i++) {
+				if (CheckCollisionAABBs(m_bounds[m_items[i]], box))
+					out.push_back(m_items[i]);
+			}
+		} else {
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+
+	std::sort(out.begin() + first, out.end());
+}
+
+void BVH::assign(std::span<Node const> nodes, std::span<u32 const> items, std::span<AABB const> bounds)
+{
+	m_nodes.assign(nodes.begin(), nodes.end());
+	m_items.assign(items.begin(), items.end());
+	m_bounds.assign(bounds.begin(), bounds.end());
+}
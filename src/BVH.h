@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "GameMath.h"
+#include "common.h"
+
+// Deepest tree query() can walk, its traversal stack is sized from this.
+constexpr u32 BVH_MAX_DEPTH = 64;
+
+// Bounding volume hierarchy over axis-aligned boxes, built top-down by splitting at the median
+// along the longest axis. Nodes live in one array and siblings are stored next to each other.
+struct BVH {
+	void build(std::vector<AABB> const &bounds);
+
+	// Appends the items whose boxes overlap `box` to `out`, in ascending order.
+	void query(AABB const &box, std::vector<u32> &out) const;
+
+	struct Node {
+		AABB bounds;
+		u32  first; // Leaf: into m_items. Inner: left child, the right one follows it.
+		u32  count; // Zero for inner nodes.
+	};
+
+	// Flat form of a built tree, used by the compiled level format to skip rebuilding it.
+	std::span<Node const> nodes(void) const { return m_nodes; }
+	std::span<u32 const>  items(void) const { return m_items; }
+	std::span<AABB const> bounds(void) const { return m_bounds; }
+	void assign(std::span<Node const> nodes, std::span<u32 const> items, std::span<AABB const> bounds);
+
+private:
+	void build_node(u32 node, std::vector<AABB> const &bounds, u32 first, u32 count);
+
+	std::vector<Node> m_nodes;
+	std::vector<u32>  m_items;
+	std::vector<AABB> m_bounds; // Per item, leaves test these individually.
+};
@@ -0,0 +1,101 @@
+#include "Counters.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+constinit Counters g_counters;
+
+char const *counter_name(Counter counter)
+{
+	switch (counter) {
+	case Counter::SegmentTests:
+		return "segment_tests";
+	case Counter::PolygonTests:
+		return "polygon_tests";
+	case Counter::Triangles:
+		return "triangles";
+	case Counter::TextureDraws:
+		return "texture_draws";
+	case Counter::SpriteBatches:
+		return "sprite_batches";
+	case Counter::ChunksDrawn:
+		return "chunks_drawn";
+	case Counter::ChunksCulled:
+		return "chunks_culled";
+	case Counter::PickupsDrawn:
+		return "pickups_drawn";
+	case Counter::PickupsCulled:
+		return "pickups_culled";
+	case Counter::Allocations:
+		return "allocations";
+	case Counter::AllocatedBytes:
+		return "allocated_bytes";
+	default:
+		unreachable();
+	}
+}
+
+void Counters::end_frame(void)
+{
+	usize const blocks = std::min(m_claimed.load(std::memory_order_relaxed), COUNTER_THREADS);
+	auto       &frame = m_history[m_frames % COUNTER_WINDOW];
+	for (usize i = 0; i < COUNTER_COUNT; i++) {
+		u64 total = 0;
+		for (usize b = 0; b < blocks; b++)
+			total += m_blocks[b].totals[i].load(std::memory_order_relaxed);
+		frame[i] = total - m_previous[i];
+		m_previous[i] = total;
+	}
+	m_frames++;
+}
+
+Counters::Summary Counters::summarize(Counter counter) const
+{
+	usize const count = this->frames();
+	if (!count)
+		return {};
+
+	usize const      index = static_cast<usize>(counter);
+	std::vector<u64> values(count);
+	for (usize i = 0; i < count; i++)
+		values[i] = m_history[i][index];
+	std::sort(values.begin(), values.end());
+
+	auto const percentile = [&](usize p) { return values[(count - 1) * p / 100]; };
+
+	u64 sum = 0;
+	for (auto const value : values)
+		sum += value;
+
+	return {
+		.last = m_history[(m_frames - 1) % COUNTER_WINDOW][index],
+		.min = values.front(),
+		.max = values.back(),
+		.p50 = percentile(50),
+		.p95 = percentile(95),
+		.p99 = percentile(99),
+		.mean = static_cast<f64>(sum) / count,
+	};
+}
+
+void Counters::export_csv(std::filesystem::path path) const
+{
+	std::ofstream f(path);
+	if (!f)
+		throw std::runtime_error("Failed to open file for writing.");
+
+	f << "frame";
+	for (usize i = 0; i < COUNTER_COUNT; i++)
+		f << ',' << counter_name(static_cast<Counter>(i));
+	f << '\n';
+
+	u64 const first = m_frames - this->frames();
+	for (u64 frame = first; frame < m_frames; frame++) {
+		f << frame;
+		for (auto const value : m_history[frame % COUNTER_WINDOW])
+			f << ',' << value;
+		f << '\n';
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+
+#include "common.h"
+
+// Frames kept for the window statistics and CSV export.
+constexpr usize COUNTER_WINDOW = 600;
+// Threads that get a block of their own, any past that share the last one.
+constexpr usize COUNTER_THREADS = 64;
+
+// Workload counts the hot paths add to, to tie a slow frame to what it was doing.
+enum class Counter : u8 {
+	SegmentTests, // Wall segments checked by Player::update().
+	PolygonTests, // CheckCollisionCirclePoly() calls.
+	Triangles, // Submitted through level meshes.
+	TextureDraws, // Sprites added to the SpriteBatch.
+	SpriteBatches, // SpriteBatch::flush() calls that drew something.
+	ChunksDrawn, // Level mesh chunks in view, see LevelMesh::draw().
+	ChunksCulled, // And out of it.
+	PickupsDrawn, // Pickups in view in Level::render().
+	PickupsCulled,
+	Allocations, // operator new calls of any form, on any thread.
+	AllocatedBytes,
+	Count,
+};
+
+constexpr usize COUNTER_COUNT = static_cast<usize>(Counter::Count);
+
+char const *counter_name(Counter counter);
+
+// Running totals, which end_frame() turns into per-frame values. Each thread adds to a block of
+// its own, so the hot paths never fight over a cache line, and end_frame() folds the blocks
+// together. Totals only grow, so nothing has to reset them under a running thread. Constant
+// initialised, so operator new can count before any constructor has run.
+struct Counters {
+	struct Summary {
+		u64 last, min, max, p50, p95, p99;
+		f64 mean;
+	};
+
+	void add(Counter counter, u64 amount = 1)
+	{
+		auto &block = this->local_block();
+		auto &total = block.totals[static_cast<usize>(counter)];
+		if (&block == &m_blocks.back()) {
+			total.fetch_add(amount, std::memory_order_relaxed);
+		} else {
+			// Only this thread writes the block, a plain store is enough.
+			total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+	}
+
+	// Records what was added since the previous call as one frame. Main thread only, as are the
+	// functions below.
+	void end_frame(void);
+
+	// Over the frames in the window, which may be fewer than COUNTER_WINDOW early on.
+	Summary summarize(Counter counter) const;
+	usize   frames(void) const { return std::min<usize>(m_frames, COUNTER_WINDOW); }
+
+	// One row per frame in the window, oldest first, one column per counter.
+	void export_csv(std::filesystem::path path) const;
+
+private:
+	using Frame = std::array<u64, COUNTER_COUNT>;
+
+	struct alignas(64) Block {
+		std::array<std::atomic<u64>, COUNTER_COUNT> totals {};
+	};
+
+	Block &local_block(void)
+	{
+		thread_local Block *block = nullptr;
+		if (!block) {
+			usize const index = m_claimed.fetch_add(1, std::memory_order_relaxed);
+			block = &m_blocks[std::min(index, COUNTER_THREADS - 1)];
+		}
+		return *block;
+	}
+
+	std::array<Block, COUNTER_THREADS> m_blocks {};
+	std::atomic<usize>                 m_claimed = 0; // Blocks handed out, may overshoot.
+	Frame                              m_previous {};
+	std::array<Frame, COUNTER_WINDOW>  m_history {};
+	u64                                m_frames = 0; // Ever recorded.
+};
+
+extern Counters g_counters;
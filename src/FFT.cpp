@@ -0,0 +1,77 @@
+#include "FFT.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+void FFT::resize(usize max_size)
+{
+	m_size = std::bit_ceil(std::max<usize>(max_size, 2));
+	usize const half = m_size / 2;
+
+	m_half_bits = 0;
+	while ((usize(1) << m_half_bits) < half)
+		m_half_bits++;
+
+	m_twiddles.resize(half);
+	for (usize k = 0; k < half; k++)
+		m_twiddles[k] = std::polar(1.0, -2.0 * std::numbers::pi * k / m_size);
+
+	m_bit_reverse.resize(half);
+	for (u32 i = 0; i < half; i++) {
+		u32 r = 0;
+		for (u32 bit = 0; bit < m_half_bits; bit++)
+			r |= ((i >> bit) & 1) << (m_half_bits - 1 - bit);
+		m_bit_reverse[i] = r;
+	}
+
+	m_buffer.resize(half);
+}
+
+usize FFT::perform(float const *input, usize count, usize stride, double *magnitudes)
+{
+	count = std::min(count, m_size);
+
+	usize n = 2;
+	u32   half_bits = 0;
+	while (n < count) {
+		n <<= 1;
+		half_bits++;
+	}
+	usize const h = n / 2;
+
+	// Pack even/odd samples as the real/imaginary parts of an n/2 point complex transform, straight
+	// into bit-reversed order. The shared table works for any smaller size by shifting it down.
+	u32 const shift = m_half_bits - half_bits;
+	for (usize k = 0; k < h; k++) {
+		double re = 2 * k < count ? input[2 * k * stride] : 0.0;
+		double im = 2 * k + 1 < count ? input[(2 * k + 1) * stride] : 0.0;
+		m_buffer[m_bit_reverse[k] >> shift] = { re, im };
+	}
+
+	for (usize len = 2; len <= h; len <<= 1) {
+		usize const half_len = len / 2;
+		usize const twiddle_step = m_size / len;
+		for (usize i = 0; i < h; i += len) {
+			for (usize j = 0; j < half_len; j++) {
+				auto const u = m_buffer[i + j];
+				auto const v = m_buffer[i + j + half_len] * m_twiddles[j * twiddle_step];
+				m_buffer[i + j] = u + v;
+				m_buffer[i + j + half_len] = u - v;
+			}
+		}
+	}
+
+	// Untangle the even and odd halves into the spectrum of the real signal.
+	usize const step = m_size / n;
+	for (usize k = 0; k < h; k++) {
+		auto const z = m_buffer[k];
+		auto const zc = std::conj(m_buffer[(h - k) % h]);
+		auto const even = (z + zc) * 0.5;
+		auto const odd = (z - zc) * std::complex<double>(0, -0.5);
+		magnitudes[k] = std::abs(even + m_twiddles[k * step] * odd);
+	}
+
+	return h;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "common.h"
+
+// Iterative radix-2 FFT for real input. All tables and scratch space are sized up front by
+// resize(), so perform() never touches the heap and is safe to call from the audio thread.
+struct FFT {
+	// Starts out with the smallest tables, so perform() is safe before any resize().
+	FFT(void) { this->resize(2); }
+
+	// `max_size` is rounded up to a power of two, longer inputs get truncated to it.
+	void resize(usize max_size);
+
+	// Transforms `count` samples, `stride` floats apart, zero padded to the next power of two n.
+	// Writes |X[k]| for k < n / 2 into `magnitudes` and returns n / 2.
+	usize perform(float const *input, usize count, usize stride, double *magnitudes);
+
+	usize max_size(void) const { return m_size; }
+
+private:
+	usize m_size = 0;
+	u32   m_half_bits = 0;
+
+	std::vector<std::complex<double>> m_twiddles; // e^(-2 pi i k / m_size) for k < m_size / 2.
+	std::vector<u32>                  m_bit_reverse; // For m_size / 2 points.
+	std::vector<std::complex<double>> m_buffer;
+};
@@ -1,8 +1,11 @@
 #include "GameMath.h"
 
-#include <raylib.h>
 #include <raymath.h>
 
+#include <cmath>
+
+#include "Counters.h"
+
 Vector2 Vector2Perpendicular(Vector2 const &v) { return { -v.y, v.x }; }
 
 Vector2 ClosestPointOnSegment(Vector2 p, Vector2 a, Vector2 b)
@@ -13,7 +16,7 @@ Vector2 ClosestPointOnSegment(Vector2 p, Vector2 a, Vector2 b)
 	return { a.x + t * ab.x, a.y + t * ab.y };
 }
 
-bool CheckCollisionPointPoly(Vector2 p, std::vector<Vector2> const &poly)
+static bool CheckCollisionPointPoly(Vector2 p, std::span<Vector2 const> poly)
 {
 	auto px = p.x;
 	auto py = p.y;
@@ -35,13 +38,20 @@ bool CheckCollisionPointPoly(Vector2 p, std::vector<Vector2> const &poly)
 	return collision;
 }
 
-bool CheckCollisionCirclePoly(Vector2 p, float r, std::vector<Vector2> const &poly, bool inside)
+// raylib's CheckCollisionPointCircle(), without linking raylib into the simulation.
+static bool PointInCircle(Vector2 point, Vector2 center, float radius)
+{
+	return Vector2DistanceSqr(point, center) <= radius * radius;
+}
+
+bool CheckCollisionCirclePoly(Vector2 p, float r, std::span<Vector2 const> poly, bool inside)
 {
+	g_counters.add(Counter::PolygonTests);
 	if (inside && CheckCollisionPointPoly(p, poly))
 		return true;
 
 	for (auto const &vertex : poly) {
-		if (CheckCollisionPointCircle(vertex, p, r)) {
+		if (PointInCircle(vertex, p, r)) {
 			return true;
 		}
 	}
@@ -50,9 +60,117 @@ bool CheckCollisionCirclePoly(Vector2 p, float r, std::vector<Vector2> const &po
 		Vector2 a = poly[i];
 		Vector2 b = poly[(i + 1) % poly.size()];
 		Vector2 closest = ClosestPointOnSegment(p, a, b);
-		if (CheckCollisionPointCircle(closest, p, r)) {
+		if (PointInCircle(closest, p, r)) {
 			return true;
 		}
 	}
 	return false;
 }
+
+static bool SweepCirclePoint(Vector2 p0, Vector2 d, Vector2 c, float radius, float &t)
+{
+	Vector2 m = Vector2Subtract(p0, c);
+	float   b = Vector2DotProduct(m, d);
+	float   cc = Vector2DotProduct(m, m) - radius * radius;
+	float   a = Vector2DotProduct(d, d);
+	if (cc <= 0 || b >= 0 || a == 0)
+		return false;
+
+	float disc = b * b - a * cc;
+	if (disc < 0)
+		return false;
+
+	t = (-b - std::sqrt(disc)) / a;
+	return t <= 1;
+}
+
+bool SweepCircleCapsule(
+    Vector2 p0, Vector2 p1, Segment const &segment, float radius, float &t, Vector2 &normal)
+{
+	Vector2 d = Vector2Subtract(p1, p0);
+	Vector2 a = segment.start;
+	Vector2 b = Vector2Add(a, segment.dir);
+	float   best = 2;
+
+	// Flat sides first, only accepted where the contact lands within the segment.
+	if (segment.inv_length_sq > 0) {
+		Vector2 n = segment.normal;
+		float   d0 = Vector2DotProduct(Vector2Subtract(p0, a), n);
+		float   d1 = Vector2DotProduct(Vector2Subtract(p1, a), n);
+		float   side = d0 >= 0 ? 1 : -1;
+		if (std::abs(d0) > radius && side * d1 < radius) {
+			float   ts = (d0 - side * radius) / (d0 - d1);
+			Vector2 contact = Vector2Add(p0, Vector2Scale(d, ts));
+			float   u = Vector2DotProduct(Vector2Subtract(contact, a), segment.dir)
+			    * segment.inv_length_sq;
+			if (u >= 0 && u <= 1) {
+				best = ts;
+				normal = Vector2Scale(n, side);
+			}
+		}
+	}
+
+	// Then the rounded caps.
+	for (Vector2 const end : { a, b }) {
+		float te;
+		if (SweepCirclePoint(p0, d, end, radius, te) && te < best) {
+			best = te;
+			normal = Vector2Normalize(Vector2Subtract(Vector2Add(p0, Vector2Scale(d, te)), end));
+		}
+	}
+
+	if (best > 1)
+		return false;
+	t = best;
+	return true;
+}
+
+AABB AABBFromPoints(std::span<Vector2 const> points)
+{
+	if (points.empty())
+		return { { 0, 0 }, { 0, 0 } };
+
+	AABB box = { points[0], points[0] };
+	for (auto const &point : points) {
+		box.min = Vector2Min(box.min, point);
+		box.max = Vector2Max(box.max, point);
+	}
+	return box;
+}
+
+AABB AABBFromSegment(Vector2 a, Vector2 b, float radius)
+{
+	return AABBGrow({ Vector2Min(a, b), Vector2Max(a, b) }, radius);
+}
+
+AABB AABBFromCamera(Camera2D const &camera, Vector2 screen)
+{
+	// GetScreenToWorld2D() for each corner, without linking raylib into the simulation.
+	auto const to_world = [&](Vector2 corner) {
+		Vector2 const local = Vector2Scale(Vector2Subtract(corner, camera.offset), 1 / camera.zoom);
+		return Vector2Add(camera.target, Vector2Rotate(local, -camera.rotation * DEG2RAD));
+	};
+
+	Vector2 const origin = to_world({ 0, 0 });
+	AABB          box = { origin, origin };
+	for (Vector2 const corner : { Vector2 { screen.x, 0 }, { 0, screen.y }, screen }) {
+		Vector2 const point = to_world(corner);
+		box = AABBUnion(box, { point, point });
+	}
+	return box;
+}
+
+AABB AABBUnion(AABB const &a, AABB const &b)
+{
+	return { Vector2Min(a.min, b.min), Vector2Max(a.max, b.max) };
+}
+
+AABB AABBGrow(AABB const &box, float amount)
+{
+	return { { box.min.x - amount, box.min.y - amount }, { box.max.x + amount, box.max.y + amount } };
+}
+
+bool CheckCollisionAABBs(AABB const &a, AABB const &b)
+{
+	return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y;
+}
@@ -1,10 +1,37 @@
 #pragma once
 
-#include <vector>
+#include <span>
 
 #include <raylib.h>
 
+struct AABB {
+	Vector2 min;
+	Vector2 max;
+};
+
+// A wall segment with its derived values worked out ahead of time, see Level::Segments.
+struct Segment {
+	Vector2 start;
+	Vector2 dir; // From start to end.
+	Vector2 normal; // Unit, dir turned a quarter counter-clockwise.
+	float   inv_length_sq; // Zero for a degenerate segment.
+};
+
 Vector2 Vector2Perpendicular(Vector2 const &v);
 Vector2 ClosestPointOnSegment(Vector2 p, Vector2 a, Vector2 b);
 bool    CheckCollisionCirclePoly(
-       Vector2 p, float r, std::vector<Vector2> const &poly, bool inside = true);
+       Vector2 p, float r, std::span<Vector2 const> poly, bool inside = true);
+
+// Time of impact of a circle moving from p0 to p1 against the capsule around `segment`, with
+// `radius` being the sum of both radii. `t` is in [0, 1] along the motion and `normal` points away
+// from the capsule. Returns false if they don't touch, or already overlap at p0.
+bool SweepCircleCapsule(
+    Vector2 p0, Vector2 p1, Segment const &segment, float radius, float &t, Vector2 &normal);
+
+AABB AABBFromPoints(std::span<Vector2 const> points);
+AABB AABBFromSegment(Vector2 a, Vector2 b, float radius);
+// The world area a `screen` sized view through `camera` shows, rotation included.
+AABB AABBFromCamera(Camera2D const &camera, Vector2 screen);
+AABB AABBUnion(AABB const &a, AABB const &b);
+AABB AABBGrow(AABB const &box, float amount);
+bool CheckCollisionAABBs(AABB const &a, AABB const &b);
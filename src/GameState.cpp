@@ -8,24 +8,7 @@ using json = nlohmann::json;
 GameState g_gs {};
 
 void GameState::render_texture(Vector2 position, int id, float angle, float size, Color tint) {
-	DrawTexturePro(
-		this->spritesheet,
-		{
-			.x = static_cast<float>(id * this->spritesheet.height),
-			.y = 0,
-			.width = static_cast<float>(this->spritesheet.height),
-			.height = static_cast<float>(this->spritesheet.height),
-		},
-		{
-			.x = position.x,
-			.y = position.y,
-			.width = size * 2,
-			.height = size * 2,
-		},
-		{ size, size },
-		angle,
-		tint
-	);
+	this->sprites.add(position, id, angle, size, tint);
 }
 
 #include <iostream>
@@ -7,9 +7,16 @@
 
 #include "Color.h"
 #include "Level.h"
+#include "LevelCatalogue.h"
+#include "LevelLayer.h"
+#include "MenuParticles.h"
 #include "Player.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "SpriteBatch.h"
 
 constexpr auto NUM_BARS = 32;
+constexpr auto DEFAULT_SIM_RATE = 120;
 
 struct GameState {
 	struct Dialog {
@@ -18,11 +25,22 @@ struct GameState {
 	};
 
 	// Game logic
-	std::vector<Level> levels;
-	Player             player;
-	f64                time_spent;
-	f64                completion_time;
-	bool               cheat = false;
+	LevelCatalogue levels;
+	Simulation     sim; // Of the current level.
+	bool           cheat = false;
+
+	// Fixed step simulation, see simulate_tick(). Rendering blends the previous tick into the
+	// current one by `sim_alpha`.
+	u32 sim_rate = DEFAULT_SIM_RATE;
+	f64 sim_accumulator = 0;
+	f32 sim_alpha = 1;
+	u8  pending_presses = 0; // InputState press bits no tick has taken yet.
+
+	// Every tick's input since the level was entered from the map, saved once it's completed.
+	// `replay` is set when playing one back, it then feeds the ticks instead of the keyboard.
+	Replay                recording;
+	std::optional<Replay> replay;
+	usize                 replay_tick = 0;
 
 	std::vector<std::vector<Dialog>> *current_dialog = nullptr;
 	// I'm sorry if you're reading this...
@@ -41,9 +59,11 @@ struct GameState {
 	Sound              explosion;
 	Sound              pickup;
 	Sound              wall_hit;
-	std::vector<Music> music;
+	std::vector<Music> music; // Not ready until AssetLoader gets to them, see IsMusicReady().
 	usize              current_song;
 
+	std::vector<std::vector<u8>> music_data; // Backs `music`, which streams from memory.
+
 	f32 sfx_volume = 1.0f;
 	f32 music_volume = 1.0f;
 
@@ -62,24 +82,27 @@ struct GameState {
 
 	std::map<std::string, std::vector<std::vector<Dialog>>> dialogs;
 
-	std::vector<Vector2> menu_particles;
-	std::vector<f32>     menu_particle_speeds;
+	MenuParticles menu_particles;
 
-	RenderTexture2D target {};
-	Camera2D        camera {};
-	Font            font;
+	LevelLayer level_layer; // Static geometry of the current level, see Level::render().
+	Camera2D   camera {};
+	Camera2D   previous_camera {};
+	Font       font;
 
-	Texture2D spritesheet;
-	Texture2D settings_icon;
+	Texture2D   spritesheet;
+	Texture2D   settings_icon;
+	SpriteBatch sprites; // Queued by render_texture(), drawn by flush_sprites().
 
+	// Always loaded while set, set_level() acquires it from the catalogue.
 	Level *level()
 	{
 		if (!current_level)
 			return nullptr;
-		return &this->levels.at(*current_level);
+		return this->levels.loaded(*current_level);
 	}
 
 	void render_texture(Vector2 position, int id, float angle, float size, Color tint);
+	void flush_sprites(void) { this->sprites.flush(this->spritesheet); }
 	void deserialize_dialogs(nlohmann::json j);
 
 	void read_dialogs_from_file(std::filesystem::path path)
@@ -94,8 +117,11 @@ struct GameState {
 
 	void show_dialog(std::string name, int idx)
 	{
-		auto &dialog = this->dialogs[name];
-		this->current_dialog = &dialog;
+		// Generated levels have dialog zones but nothing to say in them.
+		auto it = this->dialogs.find(name);
+		if (it == this->dialogs.end() || idx < 0 || static_cast<usize>(idx) >= it->second.size())
+			return;
+		this->current_dialog = &it->second;
 		this->dialog_box_y = this->heightf;
 		this->current_dialog_idx = idx;
 		this->current_dialog_dialog_idx = 0;
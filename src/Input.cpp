@@ -0,0 +1,19 @@
+#include "Input.h"
+
+#include <raylib.h>
+
+InputState InputState::poll(void)
+{
+	InputState input;
+	if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W))
+		input.bits |= Thrust;
+	if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S))
+		input.bits |= Reverse;
+	if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
+		input.bits |= Left;
+	if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
+		input.bits |= Right;
+	if (IsKeyPressed(KEY_R))
+		input.bits |= Restart;
+	return input;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+
+// Control state for a single simulation tick. The simulation reads input only through this, so
+// a run can be recorded and fed back tick by tick, see Replay.
+struct InputState {
+	enum Control : u8 {
+		Thrust = 1 << 0,
+		Reverse = 1 << 1,
+		Left = 1 << 2,
+		Right = 1 << 3,
+		Restart = 1 << 4,
+	};
+
+	u8 bits = 0;
+
+	bool held(Control control) const { return this->bits & control; }
+	bool operator==(InputState const &) const = default;
+
+	// Samples the keyboard. Restart is a key press, the others are held keys.
+	static InputState poll(void);
+};
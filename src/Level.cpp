@@ -1,15 +1,16 @@
 #include "Level.h"
 
-#include "GameState.h"
-#include "Gui.h"
+#include <bit>
+#include <iostream>
 
-#include <raylib.h>
+#include "GameMath.h"
+#include "LevelFile.h"
+#include "MappedFile.h"
 
 #include <polypartition.h>
+#include <raymath.h>
 
-#include <polypartition.h>
-
-float CalculateSignedArea(std::vector<Vector2> const &points)
+float CalculateSignedArea(std::span<Vector2 const> points)
 {
 	float  area = 0.0f;
 	size_t n = points.size();
@@ -21,64 +22,52 @@ float CalculateSignedArea(std::vector<Vector2> const &points)
 	return area * 0.5f;
 }
 
-void EnsureCounterClockwise(std::vector<Vector2> &points)
+void EnsureCounterClockwise(std::span<Vector2> points)
 {
 	if (CalculateSignedArea(points) < 0) {
 		std::reverse(points.begin(), points.end());
 	}
 }
 
-std::vector<TPPLPoint> ConvertToTPPLPoints(std::vector<Vector2> const &points)
-{
-	std::vector<TPPLPoint> polyPoints(points.size());
-	for (size_t i = 0; i < points.size(); ++i) {
-		polyPoints[i].x = points[i].x;
-		polyPoints[i].y = points[i].y;
-	}
-	return polyPoints;
-}
-
 float CalculateTriangleArea(Vector2 const &p0, Vector2 const &p1, Vector2 const &p2)
 {
 	return (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
 }
 
-void DrawTriangleCCW(Vector2 p0, Vector2 p1, Vector2 p2, Color col)
+void Level::Zone::triangulate(std::span<Vector2> points)
 {
-	if (CalculateTriangleArea(p0, p1, p2) > 0) {
-		std::swap(p1, p2);
-	}
+	this->indices.clear();
 
-	DrawTriangle(p0, p1, p2, col);
-}
-
-void DrawPolygon(std::vector<Vector2> &points, Color col)
-{
 	EnsureCounterClockwise(points);
 
 	if (points.size() < 3)
 		return;
 
-	std::vector<TPPLPoint> polyPoints = ConvertToTPPLPoints(points);
-
 	TPPLPoly polygon;
-	polygon.Init(polyPoints.size());
-	for (size_t i = 0; i < polyPoints.size(); ++i) {
-		polygon[i] = polyPoints[i];
+	polygon.Init(points.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		polygon[i].x = points[i].x;
+		polygon[i].y = points[i].y;
+		polygon[i].id = static_cast<int>(i);
 	}
 
 	std::list<TPPLPoly> triangles;
 	TPPLPartition       partitioner;
 	partitioner.Triangulate_EC(&polygon, &triangles);
 
+	this->indices.reserve(triangles.size() * 3);
 	for (TPPLPoly const &triangle : triangles) {
-		if (triangle.GetNumPoints() == 3) {
-			Vector2 p0 = { (float)triangle[0].x, (float)triangle[0].y };
-			Vector2 p1 = { (float)triangle[1].x, (float)triangle[1].y };
-			Vector2 p2 = { (float)triangle[2].x, (float)triangle[2].y };
+		if (triangle.GetNumPoints() != 3)
+			continue;
 
-			DrawTriangleCCW(p0, p1, p2, col);
-		}
+		u32 i0 = triangle[0].id, i1 = triangle[1].id, i2 = triangle[2].id;
+		// Store the winding DrawTriangle expects so rendering is a plain index walk.
+		if (CalculateTriangleArea(points[i0], points[i1], points[i2]) > 0)
+			std::swap(i1, i2);
+
+		this->indices.push_back(i0);
+		this->indices.push_back(i1);
+		this->indices.push_back(i2);
 	}
 }
 
@@ -95,6 +84,9 @@ json Level::serialize(void)
 	json j;
 	j["name"] = this->name;
 	j["files_required"] = this->files_required;
+	j["author_time"] = this->author_time;
+	if (this->on_unlock_dialog != static_cast<u32>(-1))
+		j["on_unlock_dialog"] = this->on_unlock_dialog;
 	j["start_position"] = json::array();
 	j["start_position"].push_back(this->start_position.x);
 	j["start_position"].push_back(this->start_position.y);
@@ -104,12 +96,14 @@ json Level::serialize(void)
 		json wallj;
 		wallj["kind"] = wall.kind;
 		wallj["points"] = json::array();
-		for (auto const &point : wall.points) {
+		for (auto const &point : this->points_of(wall)) {
 			json pointj;
 			pointj.push_back(point.x);
 			pointj.push_back(point.y);
 			wallj["points"].push_back(pointj);
 		}
+		if (wall.kind == Wall::Kind::Door)
+			wallj["key_id"] = wall.key_id;
 		j["walls"].push_back(wallj);
 	}
 
@@ -118,7 +112,7 @@ json Level::serialize(void)
 		json zonej;
 		zonej["kind"] = zone.kind;
 		zonej["points"] = json::array();
-		for (auto const &point : zone.points) {
+		for (auto const &point : this->points_of(zone)) {
 			json pointj;
 			pointj.push_back(point.x);
 			pointj.push_back(point.y);
@@ -132,6 +126,7 @@ json Level::serialize(void)
 			break;
 		case Zone::Kind::OneWay:
 			zonej["value"] = zone.value.one_way_angle;
+			zonej["power"] = zone.power;
 			break;
 		case Zone::Kind::Danger:
 			break;
@@ -164,14 +159,17 @@ Level Level::deserialize(nlohmann::json &data)
 		level.on_unlock_dialog = data["on_unlock_dialog"];
 
 	for (auto &wallj : data["walls"]) {
-		Wall wall;
+		Wall                 wall;
+		std::vector<Vector2> points;
 		wall.kind = wallj["kind"];
 		for (auto &pointj : wallj["points"]) {
 			Vector2 point;
 			point.x = pointj[0];
 			point.y = pointj[1];
-			wall.points.push_back(point);
+			points.push_back(point);
 		}
+		wall.first_point = level.add_points(points);
+		wall.point_count = points.size();
 		if (wall.kind == Wall::Kind::Door) {
 			wall.key_id = wallj["key_id"];
 			level.walls.emplace(level.walls.begin(), wall);
@@ -181,14 +179,18 @@ Level Level::deserialize(nlohmann::json &data)
 	}
 
 	for (auto &zonej : data["zones"]) {
-		Zone zone;
+		Zone                 zone;
+		std::vector<Vector2> points;
 		zone.kind = static_cast<Zone::Kind>(zonej["kind"].get<int>());
 		for (auto &pointj : zonej["points"]) {
 			Vector2 point;
 			point.x = pointj[0];
 			point.y = pointj[1];
-			zone.points.push_back(point);
+			points.push_back(point);
 		}
+		zone.first_point = level.add_points(points);
+		zone.point_count = points.size();
+		zone.triangulate(level.points_of(zone));
 		switch (zone.kind) {
 		case Zone::Kind::End:
 			break;
@@ -216,149 +218,205 @@ Level Level::deserialize(nlohmann::json &data)
 		level.pickups.push_back(pickup);
 	}
 
+	level.build_collision();
+
 	return level;
 }
 
-void Level::Pickup::render(Vector2 position, float radius, float theta) const
+void Level::export_to_binary(std::filesystem::path path) const
 {
-	if (!radius)
-		return;
-	Color pickup_color
-	    = this->kind == Level::Pickup::Kind::Key ? g_gs.palette.key_door : g_gs.palette.file;
-	int id;
-	switch (this->kind) {
-	case Kind::Key:
-		id = 1;
-		break;
-	case Kind::File:
-		id = 2;
-		break;
+	auto const    bytes = LevelFile::encode(*this);
+	std::ofstream f(path, std::ios::binary);
+	if (!f)
+		throw std::runtime_error("Failed to open file for writing.");
+	f.write(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+}
+
+Level Level::read_from_binary(std::filesystem::path path)
+{
+	MappedFile const mapped(path);
+	auto const       file = LevelFile::parse(mapped.bytes());
+	auto const      &header = *file.header;
+
+	Level level(std::string(file.name), header.files_required);
+	level.author_time = header.author_time;
+	level.start_position = header.start_position;
+	level.start_angle = header.start_angle;
+	level.on_unlock_dialog = header.on_unlock_dialog;
+
+	level.points.assign(file.points.begin(), file.points.end());
+
+	level.walls.reserve(file.walls.size());
+	for (auto const &record : file.walls) {
+		Wall wall;
+		wall.kind = static_cast<Wall::Kind>(record.kind);
+		wall.key_id = record.key_id;
+		wall.first_point = record.first_point;
+		wall.point_count = record.point_count;
+		wall.first_segment = record.first_segment;
+		level.walls.push_back(std::move(wall));
+	}
+
+	level.zones.reserve(file.zones.size());
+	for (u32 z = 0; z < file.zones.size(); z++) {
+		auto const &record = file.zones[z];
+		auto const  indices = file.indices.subspan(record.first_index, record.index_count);
+		Zone        zone;
+		zone.kind = static_cast<Zone::Kind>(record.kind);
+		zone.value = std::bit_cast<decltype(zone.value)>(record.value);
+		zone.power = record.power;
+		zone.first_point = record.first_point;
+		zone.point_count = record.point_count;
+		zone.indices.assign(indices.begin(), indices.end());
+		zone.bounds = record.bounds;
+		if (zone.kind == Zone::Kind::DialogTrigger)
+			level.dialog_zones.push_back(z);
+		level.zones.push_back(std::move(zone));
+	}
+
+	level.pickups.reserve(file.pickups.size());
+	for (auto const &record : file.pickups) {
+		Pickup pickup;
+		pickup.kind = static_cast<Pickup::Kind>(record.kind);
+		pickup.id = record.id;
+		pickup.position = record.position;
+		level.pickups.push_back(pickup);
+	}
+
+	// The records stay in file order, the grid refers to segments by their position in it.
+	for (auto const &record : file.segments) {
+		auto const points = level.points_of(level.walls[record.wall]);
+		level.segments.push_back(record.wall, points[record.index], points[record.index + 1]);
 	}
-	g_gs.render_texture(position, id, theta, radius, pickup_color);
+	level.wall_grid.assign(header.grid, file.grid_cells, file.grid_items, file.segments.size());
+	level.zone_bvh.assign(file.bvh_nodes, file.bvh_items, file.bvh_bounds);
+
+	return level;
 }
 
-void Level::render(Camera2D *camera, bool origin, bool render_player)
+std::filesystem::path Level::compiled_path(std::filesystem::path const &path)
 {
-	if (origin)
-		DrawCircle(0, 0, 2, GREEN);
-
-	BeginMode2D(*camera);
-	{
-		for (auto &zone : this->zones) {
-			Color col;
-			switch (zone.kind) {
-			case Zone::Kind::End:
-			case Zone::Kind::DialogTrigger:
-				col = { 0, 0, 0, 0 };
-				break;
-			case Zone::Kind::OneWay:
-				col = g_gs.palette.one_way_zone_background;
-				break;
-			case Zone::Kind::Danger:
-				col = g_gs.palette.danger_zone_background;
-				break;
-			}
-			DrawPolygon(zone.points, col);
-		}
+	auto binary = path;
+	binary.replace_extension(".lvl");
+
+	std::error_code ec;
+	if (!std::filesystem::exists(binary, ec))
+		return {};
+	auto const json_time = std::filesystem::last_write_time(path, ec);
+	if (!ec && std::filesystem::last_write_time(binary, ec) < json_time)
+		return {};
+	return binary;
+}
 
-		for (auto const &wall : this->walls) {
-			if (wall.time_since_trigger != -1)
-				continue;
-
-			Color wall_color
-			    = wall.kind == Level::Wall::Kind::Wall ? g_gs.palette.wall : g_gs.palette.key_door;
-			for (usize i = 0; i < wall.points.size() - 1; i++) {
-				auto first = wall.points.at(i);
-				auto second = wall.points.at(i + 1);
-				DrawLineEx(first, second, WALL_THICKNESS, wall_color);
-				DrawCircleV(first, WALL_THICKNESS / 2, wall_color);
-				DrawCircleV(second, WALL_THICKNESS / 2, wall_color);
-			}
+Level Level::load(std::filesystem::path path)
+{
+	if (auto const binary = compiled_path(path); !binary.empty()) {
+		try {
+			return read_from_binary(binary);
+		} catch (std::runtime_error const &e) {
+			std::cerr << "Ignoring " << binary.string() << ": " << e.what() << std::endl;
 		}
+	}
 
-		for (auto const &pickup : this->pickups) {
-			auto radius = PICKUP_RADIUS;
-			if (pickup.time_since_pickup != -1) {
-				if (pickup.time_since_pickup <= .3) {
-					radius *= (.3 - pickup.time_since_pickup) / .3;
-				} else {
-					radius = 0;
-				}
-			}
-
-			pickup.render(pickup.position, radius, 0);
-		}
+	return read_from_file(path);
+}
 
-		if (render_player)
-			g_gs.player.render();
-	}
-	EndMode2D();
+usize Level::memory_usage(void) const
+{
+	usize bytes = sizeof(Level) + this->name.capacity();
+	bytes += this->walls.capacity() * sizeof(Wall);
+	for (auto const &zone : this->zones)
+		bytes += sizeof(Zone) + zone.indices.capacity() * sizeof(u32);
+	bytes += this->pickups.capacity() * sizeof(Pickup);
+	bytes += this->points.capacity() * sizeof(Vector2);
+	bytes += this->segments.memory_usage();
+	bytes += this->wall_grid.cell_starts().size_bytes() + this->wall_grid.items().size_bytes()
+	    + this->wall_grid.item_count();
+	bytes += this->zone_bvh.nodes().size_bytes() + this->zone_bvh.items().size_bytes()
+	    + this->zone_bvh.bounds().size_bytes();
+	return bytes;
 }
 
-float ease_out_lerp(float start, float end, float t)
+u32 Level::add_points(std::span<Vector2 const> outline)
 {
-	t = 1 - (1 - t) * (1 - t);
-	return start + t * (end - start);
+	u32 const first = this->points.size();
+	this->points.insert(this->points.end(), outline.begin(), outline.end());
+	return first;
 }
 
-float limit(float x, float min, float max)
+void Level::Segments::clear(void)
 {
-	if (x < min)
-		return min;
-	if (x > max)
-		return max;
-	return x;
+	for (auto *array : { &this->start_x, &this->start_y, &this->dir_x, &this->dir_y,
+	         &this->inv_length_sq, &this->normal_x, &this->normal_y })
+		array->clear();
+	this->wall.clear();
 }
 
-void Level::render_hud(f64 t)
+void Level::Segments::push_back(u32 wall, Vector2 start, Vector2 end)
 {
-	constexpr float WIDTH = 500;
-	constexpr float HEIGHT = 320;
-
-	float x = g_gs.widthf / 2 - WIDTH / 2;
-	float y = ease_out_lerp(g_gs.heightf, g_gs.heightf / 2 - HEIGHT / 2, limit(t, 0, 1));
-
-	DrawRectangle(x - BORDER_WIDTH, y - BORDER_WIDTH, WIDTH + BORDER_WIDTH * 2,
-	    HEIGHT + BORDER_WIDTH * 2, g_gs.palette.primary);
-	DrawRectangle(x, y, WIDTH, HEIGHT, g_gs.palette.menu_background);
-	constexpr auto text = "DATA SENT";
-	constexpr auto text_size = 40;
-
-	float start_x = x + WIDTH / 2
-	    - MeasureTextEx(g_gs.font, " ", text_size * 2, 0).x * 1.5 * (strlen(text) - 1) * .5 - 15;
-	for (size_t i = 0; i < strlen(text); ++i) {
-		float char_x = start_x + i * MeasureTextEx(g_gs.font, " ", text_size * 2, 0).x * 1.5;
-		float bounce_offset = sin(t * 3.0f + i * 0.3f) * 10.0f - 15;
-		DrawTextEx(g_gs.font, TextSubtext(text, i, 1), { char_x, y + text_size + bounce_offset },
-		    text_size * 2, 0, g_gs.palette.primary);
-	}
+	Vector2 const dir = Vector2Subtract(end, start);
+	f32 const     length_sq = Vector2DotProduct(dir, dir);
+	Vector2 const normal = Vector2Normalize(Vector2Perpendicular(dir));
+
+	this->wall.push_back(wall);
+	this->start_x.push_back(start.x);
+	this->start_y.push_back(start.y);
+	this->dir_x.push_back(dir.x);
+	this->dir_y.push_back(dir.y);
+	this->inv_length_sq.push_back(length_sq > 0 ? 1 / length_sq : 0);
+	this->normal_x.push_back(normal.x);
+	this->normal_y.push_back(normal.y);
+}
 
-	constexpr auto PADDING = 20;
-	constexpr auto FONT_SIZE = 30;
-	constexpr auto FONT_SPACING = 2;
-	float          off = y + text_size * 2 + PADDING * 2;
-	if (t > .75) {
-		auto time = std::string(format_time(g_gs.completion_time));
-		DrawTextEx(g_gs.font, TextFormat("Completion time: %s", time.c_str()), { x + PADDING, off },
-		    FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
-		off += FONT_SIZE * .75 + PADDING / 2;
-	}
-	if (t > 1) {
-		DrawTextEx(g_gs.font,
-		    TextFormat("Files collected: %d/%d", this->collected_files, this->total_files),
-		    { x + PADDING, off }, FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
-		off += FONT_SIZE * .75 + PADDING / 2;
-	}
-	if (t > 1.25) {
-		auto time = std::string(format_time(this->author_time));
-		DrawTextEx(g_gs.font, TextFormat("Author completion time: %s", time.c_str()),
-		    { x + PADDING, off }, FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
-		off += FONT_SIZE * .75 + PADDING / 2;
+usize Level::Segments::memory_usage(void) const
+{
+	usize bytes = this->wall.capacity() * sizeof(u32);
+	for (auto const *array : { &this->start_x, &this->start_y, &this->dir_x, &this->dir_y,
+	         &this->inv_length_sq, &this->normal_x, &this->normal_y })
+		bytes += array->capacity() * sizeof(f32);
+	return bytes;
+}
+
+void Level::build_collision(void)
+{
+	this->segments.clear();
+
+	std::vector<AABB> bounds;
+	for (u32 w = 0; w < this->walls.size(); w++) {
+		auto &wall = this->walls[w];
+		wall.first_segment = this->segments.size();
+		auto const points = this->points_of(wall);
+		for (u32 i = 0; i + 1 < points.size(); i++) {
+			this->segments.push_back(w, points[i], points[i + 1]);
+			bounds.push_back(AABBFromSegment(points[i], points[i + 1], WALL_THICKNESS / 2.f));
+		}
 	}
-	off += FONT_SIZE * .75 + PADDING / 2;
-	if (t > 1.5) {
-		if (GuiButton(
-		        { x + PADDING, static_cast<float>(off), WIDTH - PADDING * 2, 50 }, "Back to map"))
-			g_gs.current_level = {};
+
+	this->wall_grid.build(bounds, WALL_GRID_CELL_SIZE);
+
+	bounds.clear();
+	this->dialog_zones.clear();
+	for (u32 z = 0; z < this->zones.size(); z++) {
+		auto &zone = this->zones[z];
+		zone.bounds = AABBFromPoints(this->points_of(zone));
+		bounds.push_back(zone.bounds);
+		if (zone.kind == Zone::Kind::DialogTrigger)
+			this->dialog_zones.push_back(z);
 	}
+	this->zone_bvh.build(bounds);
+}
+
+void Level::open_door(usize wall)
+{
+	auto &door = this->walls.at(wall);
+	door.time_since_trigger = 0;
+	for (usize i = 0; i + 1 < door.point_count; i++)
+		this->wall_grid.set_enabled(door.first_segment + i, false);
+}
+
+void Level::reset_doors(void)
+{
+	for (auto &wall : this->walls)
+		wall.time_since_trigger = -1;
+	this->wall_grid.enable_all();
 }
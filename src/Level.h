@@ -2,16 +2,22 @@
 
 #include <filesystem>
 #include <fstream>
+#include <span>
 #include <string>
 #include <vector>
 
 #include <nlohmann/json.hpp>
 #include <raylib.h>
 
+#include "BVH.h"
+#include "GameMath.h"
+#include "LevelMesh.h"
+#include "UniformGrid.h"
 #include "common.h"
 
 constexpr auto WALL_THICKNESS = 8;
 constexpr auto PICKUP_RADIUS = 10;
+constexpr auto WALL_GRID_CELL_SIZE = 64;
 
 struct Level {
 	struct Wall {
@@ -20,11 +26,12 @@ struct Level {
 			Door,
 		};
 
-		Kind                 kind;
-		std::vector<Vector2> points;
-		u8                   key_id;
+		Kind kind;
+		u32  first_point = 0, point_count = 0; // Into Level::points, see points_of().
+		u8   key_id;
 
 		f64 time_since_trigger = -1;
+		u32 first_segment = 0; // Into Level::segments, see build_collision().
 	};
 
 	struct Zone {
@@ -35,8 +42,8 @@ struct Level {
 			Danger,
 		};
 
-		Kind                 kind;
-		std::vector<Vector2> points;
+		Kind kind;
+		u32  first_point = 0, point_count = 0; // Into Level::points, see points_of().
 
 		union {
 			i32 dialog_index;
@@ -45,6 +52,15 @@ struct Level {
 		f32 power;
 
 		f64 time_since_trigger = -1;
+
+		AABB bounds {}; // Of its points, refreshed by Level::build_collision().
+
+		// Triangle list into the zone's points, built once by triangulate(). Anything that edits
+		// them (e.g. the level editor) has to call triangulate() again afterwards.
+		std::vector<u32> indices;
+
+		// Takes the zone's own points, see points_of(), and makes them counter-clockwise.
+		void triangulate(std::span<Vector2> points);
 	};
 
 	struct Pickup {
@@ -85,6 +101,66 @@ struct Level {
 		return deserialize(j);
 	}
 
+	// Compiled form with the collision structures prebuilt, see LevelFile.
+	void         export_to_binary(std::filesystem::path path) const;
+	static Level read_from_binary(std::filesystem::path path);
+
+	// Reads the compiled `.lvl` next to a level's JSON when it's at least as new as the JSON,
+	// falling back to the JSON otherwise.
+	static Level load(std::filesystem::path path);
+	// That `.lvl` path, or an empty one if there's no up to date compiled file.
+	static std::filesystem::path compiled_path(std::filesystem::path const &path);
+
+	// Rough CPU-side footprint, used to budget the level cache.
+	usize memory_usage(void) const;
+
+	// What collision needs of every wall segment, precomputed once and kept as separate arrays
+	// so segment tests stream through memory instead of chasing each wall's points.
+	struct Segments {
+		std::vector<u32> wall;
+		std::vector<f32> start_x, start_y;
+		std::vector<f32> dir_x, dir_y; // From start to end.
+		std::vector<f32> inv_length_sq; // Of dir, zero for a degenerate segment.
+		std::vector<f32> normal_x, normal_y; // Unit, dir turned a quarter counter-clockwise.
+
+		usize size(void) const { return this->wall.size(); }
+
+		Segment get(u32 s) const
+		{
+			return {
+				.start = { this->start_x[s], this->start_y[s] },
+				.dir = { this->dir_x[s], this->dir_y[s] },
+				.normal = { this->normal_x[s], this->normal_y[s] },
+				.inv_length_sq = this->inv_length_sq[s],
+			};
+		}
+
+		void  clear(void);
+		void  push_back(u32 wall, Vector2 start, Vector2 end);
+		usize memory_usage(void) const;
+	};
+
+	// Appends an outline to `points`, for a new wall's or zone's first_point.
+	u32 add_points(std::span<Vector2 const> outline);
+
+	template <typename Shape>
+	std::span<Vector2> points_of(Shape const &shape)
+	{
+		return { this->points.data() + shape.first_point, shape.point_count };
+	}
+	template <typename Shape>
+	std::span<Vector2 const> points_of(Shape const &shape) const
+	{
+		return { this->points.data() + shape.first_point, shape.point_count };
+	}
+
+	// Rebuilds the wall grid and zone BVH, has to run again whenever wall or zone points change.
+	void build_collision(void);
+
+	// Door state goes through these so the collision grid stays in sync with it.
+	void open_door(usize wall);
+	void reset_doors(void);
+
 	void render(Camera2D *camera, bool origin = false, bool render_player = true);
 	void render_hud(f64 t);
 
@@ -95,11 +171,16 @@ struct Level {
 	f32         start_angle;
 	u32         on_unlock_dialog = -1;
 
-	std::vector<Wall>                walls;
-	std::vector<Zone>                zones;
-	std::vector<Pickup>              pickups;
+	std::vector<Wall>    walls;
+	std::vector<Zone>    zones;
+	std::vector<Pickup>  pickups;
+	std::vector<Vector2> points; // Every wall's and zone's outline, back to back.
 
 	// Non-serialized
-	bool did_initial_dialog = false;
-	int collected_files = 0, total_files = 0;
+	Segments         segments;
+	UniformGrid      wall_grid; // Over `segments`, doors drop out once opened.
+	BVH              zone_bvh; // Over Zone::bounds.
+	std::vector<u32> dialog_zones; // Their trigger timers tick without a BVH query.
+	LevelMesh        mesh; // Built on first render, see LevelMesh.
+	std::vector<u32> visible_pickups; // Scratch for render().
 };
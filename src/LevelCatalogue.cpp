@@ -0,0 +1,108 @@
+#include "LevelCatalogue.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "LevelFile.h"
+#include "MappedFile.h"
+
+using json = nlohmann::json;
+
+static void read_metadata(LevelCatalogue::Entry &entry)
+{
+	if (auto const binary = Level::compiled_path(entry.path); !binary.empty()) {
+		try {
+			MappedFile const mapped(binary);
+			auto const       file = LevelFile::parse_header(mapped.bytes());
+			entry.name = file.name;
+			entry.files_required = file.header->files_required;
+			entry.on_unlock_dialog = file.header->on_unlock_dialog;
+			return;
+		} catch (std::runtime_error const &e) {
+			std::cerr << "Ignoring " << binary.string() << ": " << e.what() << std::endl;
+		}
+	}
+
+	std::ifstream f(entry.path);
+	if (!f)
+		throw std::runtime_error("Failed to open file for reading.");
+
+	// Geometry makes up nearly all of a level, so drop it while parsing instead of building it.
+	auto const skip_geometry = [](int depth, json::parse_event_t event, json &parsed) {
+		return !(depth == 1 && event == json::parse_event_t::key
+		    && (parsed == "walls" || parsed == "zones" || parsed == "pickups"));
+	};
+	auto data = json::parse(f, skip_geometry);
+
+	entry.name = data["name"];
+	entry.files_required = data["files_required"].get<u16>();
+	if (!data["on_unlock_dialog"].is_null())
+		entry.on_unlock_dialog = data["on_unlock_dialog"];
+}
+
+void LevelCatalogue::scan(std::filesystem::path const &directory)
+{
+	this->unload_all();
+	m_entries.clear();
+
+	for (int i = 0;; i++) {
+		Entry entry;
+		// Not TextFormat(), this may run on a loader thread.
+		entry.path = directory / ("Level" + std::to_string(i) + ".json");
+		if (!std::filesystem::exists(entry.path))
+			break;
+		read_metadata(entry);
+		m_entries.push_back(std::move(entry));
+	}
+}
+
+Level &LevelCatalogue::acquire(usize index)
+{
+	auto it = std::find_if(
+	    m_cache.begin(), m_cache.end(), [&](Slot const &slot) { return slot.index == index; });
+	if (it != m_cache.end()) {
+		std::rotate(it, it + 1, m_cache.end());
+		return *m_cache.back().level;
+	}
+
+	auto level = std::make_unique<Level>(Level::load(this->entry(index).path));
+	usize const bytes = level->memory_usage();
+	m_cache.push_back({ index, bytes, std::move(level) });
+	m_cached_bytes += bytes;
+	this->evict();
+	return *m_cache.back().level;
+}
+
+Level *LevelCatalogue::loaded(usize index)
+{
+	for (auto &slot : m_cache) {
+		if (slot.index == index)
+			return slot.level.get();
+	}
+	return nullptr;
+}
+
+void LevelCatalogue::evict(void)
+{
+	// The most recently used level is the one being played, so it always stays.
+	usize count = 0;
+	while (count + 1 < m_cache.size() && m_cached_bytes > this->memory_budget) {
+		if (this->on_evict)
+			this->on_evict(*m_cache[count].level);
+		m_cached_bytes -= m_cache[count].bytes;
+		count++;
+	}
+	m_cache.erase(m_cache.begin(), m_cache.begin() + count);
+}
+
+void LevelCatalogue::unload_all(void)
+{
+	for (auto &slot : m_cache) {
+		if (this->on_evict)
+			this->on_evict(*slot.level);
+	}
+	m_cache.clear();
+	m_cached_bytes = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Level.h"
+#include "common.h"
+
+// Estimated CPU-side bytes of loaded levels kept around before the least recently played ones
+// are dropped. The level being played is never evicted, whatever its size.
+constexpr usize DEFAULT_LEVEL_CACHE_BUDGET = 64 * 1024 * 1024;
+
+// Every installed level, with only what the map screen needs read up front. Geometry is loaded
+// on first use and kept in a least recently used cache capped at `memory_budget`.
+struct LevelCatalogue {
+	struct Entry {
+		std::filesystem::path path; // Of the JSON, see Level::load().
+		std::string           name;
+		u16                   files_required = 0;
+		u32                   on_unlock_dialog = -1;
+
+		// Progress lives here rather than on Level so it survives eviction.
+		bool did_initial_dialog = false;
+		int  collected_files = 0, total_files = 0;
+	};
+
+	// Reads the metadata of Level0.json, Level1.json, ... up to the first missing index.
+	void scan(std::filesystem::path const &directory);
+
+	// Loads the level if it isn't cached and marks it most recently used, which may evict others.
+	Level &acquire(usize index);
+	// The cached level, or nullptr if it isn't loaded.
+	Level *loaded(usize index);
+	// Drops every cached level, passing each to `on_evict` first.
+	void unload_all(void);
+
+	std::vector<Entry> const &entries(void) const { return m_entries; }
+	Entry                    &entry(usize index) { return m_entries.at(index); }
+	usize                     size(void) const { return m_entries.size(); }
+	usize                     cached_bytes(void) const { return m_cached_bytes; }
+
+	usize memory_budget = DEFAULT_LEVEL_CACHE_BUDGET;
+	// Runs on a level about to be dropped, the game unloads its meshes here.
+	std::function<void(Level &)> on_evict;
+
+private:
+	struct Slot {
+		usize                  index;
+		usize                  bytes;
+		std::unique_ptr<Level> level;
+	};
+
+	void evict(void);
+
+	std::vector<Entry> m_entries;
+	std::vector<Slot>  m_cache; // Least recently used first.
+	usize              m_cached_bytes = 0;
+};
@@ -0,0 +1,225 @@
+#include "LevelFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<LevelFile::Header>);
+static_assert(std::is_trivially_copyable_v<LevelFile::WallRecord>);
+static_assert(std::is_trivially_copyable_v<LevelFile::ZoneRecord>);
+static_assert(std::is_trivially_copyable_v<LevelFile::PickupRecord>);
+static_assert(std::is_trivially_copyable_v<LevelFile::SegmentRecord>);
+static_assert(std::is_trivially_copyable_v<BVH::Node>);
+static_assert(alignof(LevelFile::Header) <= 8);
+
+constexpr usize SECTION_ALIGNMENT = 8;
+
+template <typename T>
+static LevelFile::Section append_section(std::vector<u8> &out, std::span<T const> data)
+{
+	out.resize((out.size() + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1));
+	LevelFile::Section section { static_cast<u32>(out.size()), static_cast<u32>(data.size()) };
+	out.resize(out.size() + data.size_bytes());
+	if (!data.empty())
+		std::memcpy(out.data() + section.offset, data.data(), data.size_bytes());
+	return section;
+}
+
+std::vector<u8> LevelFile::encode(Level const &level)
+{
+	Header header {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.files_required = level.files_required;
+	header.author_time = level.author_time;
+	header.start_position = level.start_position;
+	header.start_angle = level.start_angle;
+	header.on_unlock_dialog = level.on_unlock_dialog;
+	header.grid = level.wall_grid.layout();
+
+	std::vector<WallRecord>    walls;
+	std::vector<ZoneRecord>    zones;
+	std::vector<PickupRecord>  pickups;
+	std::vector<u32>           indices;
+	std::vector<SegmentRecord> segments;
+
+	// Level::points is already laid out the way the file wants it.
+	for (auto const &wall : level.walls) {
+		walls.push_back({ static_cast<u32>(wall.kind), wall.key_id, wall.first_point,
+		    wall.point_count, wall.first_segment });
+	}
+
+	for (auto const &zone : level.zones) {
+		zones.push_back({ static_cast<u32>(zone.kind), std::bit_cast<u32>(zone.value), zone.power,
+		    zone.first_point, zone.point_count, static_cast<u32>(indices.size()),
+		    static_cast<u32>(zone.indices.size()), zone.bounds });
+		indices.insert(indices.end(), zone.indices.begin(), zone.indices.end());
+	}
+
+	segments.reserve(level.segments.size());
+	for (u32 s = 0; s < level.segments.size(); s++) {
+		u32 const wall = level.segments.wall[s];
+		segments.push_back({ wall, s - level.walls[wall].first_segment });
+	}
+
+	for (auto const &pickup : level.pickups)
+		pickups.push_back({ static_cast<u32>(pickup.kind), pickup.id, pickup.position });
+
+	std::vector<u8> out(sizeof(Header));
+	header.name = append_section(out, std::span<char const>(level.name));
+	header.walls = append_section<WallRecord>(out, walls);
+	header.zones = append_section<ZoneRecord>(out, zones);
+	header.pickups = append_section<PickupRecord>(out, pickups);
+	header.points = append_section<Vector2>(out, level.points);
+	header.indices = append_section<u32>(out, indices);
+	header.segments = append_section<SegmentRecord>(out, segments);
+	header.grid_cells = append_section(out, level.wall_grid.cell_starts());
+	header.grid_items = append_section(out, level.wall_grid.items());
+	header.bvh_nodes = append_section(out, level.zone_bvh.nodes());
+	header.bvh_items = append_section(out, level.zone_bvh.items());
+	header.bvh_bounds = append_section(out, level.zone_bvh.bounds());
+	header.size = static_cast<u32>(out.size());
+
+	std::memcpy(out.data(), &header, sizeof(Header));
+	return out;
+}
+
+template <typename T>
+static std::span<T const> view_section(std::span<u8 const> bytes, LevelFile::Section section)
+{
+	if (section.offset % alignof(T) != 0 || section.offset > bytes.size()
+	    || section.count > (bytes.size() - section.offset) / sizeof(T))
+		throw std::runtime_error("Level file section out of bounds.");
+	return { reinterpret_cast<T const *>(bytes.data() + section.offset), section.count };
+}
+
+static void check_range(u32 first, u32 count, usize size)
+{
+	if (first > size || count > size - first)
+		throw std::runtime_error("Level file range out of bounds.");
+}
+
+// Finite and not inside out, NaN fails the comparisons.
+static bool is_valid(AABB const &box)
+{
+	return std::isfinite(box.min.x) && std::isfinite(box.min.y) && std::isfinite(box.max.x)
+	    && std::isfinite(box.max.y) && box.min.x <= box.max.x && box.min.y <= box.max.y;
+}
+
+LevelFile LevelFile::parse_header(std::span<u8 const> bytes)
+{
+	if (bytes.size() < sizeof(Header)
+	    || reinterpret_cast<uintptr_t>(bytes.data()) % alignof(Header) != 0)
+		throw std::runtime_error("Level file too small or misaligned.");
+
+	LevelFile file;
+	file.header = reinterpret_cast<Header const *>(bytes.data());
+	auto const &header = *file.header;
+	if (header.magic != MAGIC)
+		throw std::runtime_error("Not a level file.");
+	if (header.version != VERSION)
+		throw std::runtime_error("Unsupported level file version.");
+	if (header.size != bytes.size())
+		throw std::runtime_error("Level file is truncated.");
+
+	auto const name = view_section<char>(bytes, header.name);
+	file.name = { name.data(), name.size() };
+	return file;
+}
+
+LevelFile LevelFile::parse(std::span<u8 const> bytes)
+{
+	auto        file = parse_header(bytes);
+	auto const &header = *file.header;
+	file.walls = view_section<WallRecord>(bytes, header.walls);
+	file.zones = view_section<ZoneRecord>(bytes, header.zones);
+	file.pickups = view_section<PickupRecord>(bytes, header.pickups);
+	file.points = view_section<Vector2>(bytes, header.points);
+	file.indices = view_section<u32>(bytes, header.indices);
+	file.segments = view_section<SegmentRecord>(bytes, header.segments);
+	file.grid_cells = view_section<u32>(bytes, header.grid_cells);
+	file.grid_items = view_section<u32>(bytes, header.grid_items);
+	file.bvh_nodes = view_section<BVH::Node>(bytes, header.bvh_nodes);
+	file.bvh_items = view_section<u32>(bytes, header.bvh_items);
+	file.bvh_bounds = view_section<AABB>(bytes, header.bvh_bounds);
+
+	for (auto const &wall : file.walls) {
+		if (wall.kind > static_cast<u32>(Level::Wall::Kind::Door))
+			throw std::runtime_error("Level file wall kind is invalid.");
+		check_range(wall.first_point, wall.point_count, file.points.size());
+		check_range(wall.first_segment, wall.point_count ? wall.point_count - 1 : 0,
+		    file.segments.size());
+	}
+	for (auto const &zone : file.zones) {
+		if (zone.kind > static_cast<u32>(Level::Zone::Kind::Danger))
+			throw std::runtime_error("Level file zone kind is invalid.");
+		check_range(zone.first_point, zone.point_count, file.points.size());
+		check_range(zone.first_index, zone.index_count, file.indices.size());
+		for (auto const i : file.indices.subspan(zone.first_index, zone.index_count)) {
+			if (i >= zone.point_count)
+				throw std::runtime_error("Level file zone index out of bounds.");
+		}
+	}
+	for (auto const &pickup : file.pickups) {
+		if (pickup.kind > static_cast<u32>(Level::Pickup::Kind::File))
+			throw std::runtime_error("Level file pickup kind is invalid.");
+	}
+	for (auto const &segment : file.segments) {
+		if (segment.wall >= file.walls.size()
+		    || segment.index + 1 >= file.walls[segment.wall].point_count)
+			throw std::runtime_error("Level file segment out of bounds.");
+	}
+
+	// The grid and BVH are walked without bounds checks at runtime, so check them here once.
+	auto const &grid = header.grid;
+	usize const cells = static_cast<usize>(std::max(grid.columns, 0)) * std::max(grid.rows, 0);
+	if (grid.columns < 0 || grid.rows < 0 || (grid.columns == 0) != (grid.rows == 0)
+	    || file.grid_cells.size() != (cells ? cells + 1 : 0)
+	    || (cells ? file.grid_cells.back() : 0) != file.grid_items.size()
+	    || (cells
+	        && (!std::isfinite(grid.cell_size) || grid.cell_size <= 0 || !is_valid(grid.bounds))))
+		throw std::runtime_error("Level file grid is malformed.");
+	for (usize i = 0; i + 1 < file.grid_cells.size(); i++) {
+		if (file.grid_cells[i] > file.grid_cells[i + 1])
+			throw std::runtime_error("Level file grid is malformed.");
+	}
+	for (auto const item : file.grid_items) {
+		if (item >= file.segments.size())
+			throw std::runtime_error("Level file grid is malformed.");
+	}
+
+	if (file.bvh_bounds.size() != file.zones.size())
+		throw std::runtime_error("Level file BVH is malformed.");
+	for (auto const item : file.bvh_items) {
+		if (item >= file.zones.size())
+			throw std::runtime_error("Level file BVH is malformed.");
+	}
+	for (auto const &box : file.bvh_bounds) {
+		if (!is_valid(box))
+			throw std::runtime_error("Level file BVH is malformed.");
+	}
+	// BVH::query() never holds more nodes on its stack than the tree is deep.
+	std::vector<u32> depths(file.bvh_nodes.size(), 1);
+	for (usize i = 0; i < file.bvh_nodes.size(); i++) {
+		auto const &node = file.bvh_nodes[i];
+		if (!is_valid(node.bounds))
+			throw std::runtime_error("Level file BVH is malformed.");
+		// Children always come after their parent, which also rules out cycles.
+		if (node.count) {
+			check_range(node.first, node.count, file.bvh_items.size());
+		} else if (node.first <= i || static_cast<u64>(node.first) + 1 >= file.bvh_nodes.size()) {
+			throw std::runtime_error("Level file BVH is malformed.");
+		} else {
+			// Parents are visited first, so their depth is final by now.
+			for (auto const child : { node.first, node.first + 1 })
+				depths[child] = std::max(depths[child], depths[i] + 1);
+		}
+		if (depths[i] > BVH_MAX_DEPTH)
+			throw std::runtime_error("Level file BVH is too deep.");
+	}
+
+	return file;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "BVH.h"
+#include "GameMath.h"
+#include "Level.h"
+#include "UniformGrid.h"
+#include "common.h"
+
+// Compiled level format, written by the LevelCompiler tool next to each LevelN.json.
+//
+// A fixed header followed by flat sections, each 8-byte aligned and addressed by its offset from
+// the start of the file. Besides the level data it carries the already built wall grid and zone
+// BVH, so loading is validating the ranges and copying arrays, with no JSON parsing,
+// triangulation or acceleration structure builds. Native endianness, the files are built per
+// target by the `compile_levels` target.
+struct LevelFile {
+	static constexpr u32 MAGIC = 'B' | 'R' << 8 | 'L' << 16 | 'V' << 24;
+	static constexpr u32 VERSION = 1;
+
+	struct Section {
+		u32 offset;
+		u32 count; // In elements, not bytes.
+	};
+
+	struct WallRecord {
+		u32 kind;
+		u32 key_id;
+		u32 first_point;
+		u32 point_count;
+		u32 first_segment;
+	};
+
+	struct ZoneRecord {
+		u32  kind;
+		u32  value; // Bits of Zone::value.
+		f32  power;
+		u32  first_point;
+		u32  point_count;
+		u32  first_index; // Indices are relative to the zone's first point.
+		u32  index_count;
+		AABB bounds;
+	};
+
+	struct SegmentRecord {
+		u32 wall;
+		u32 index; // Segment runs from the wall's points[index] to points[index + 1].
+	};
+
+	struct PickupRecord {
+		u32     kind;
+		i32     id;
+		Vector2 position;
+	};
+
+	struct Header {
+		u32 magic;
+		u32 version;
+		u32 size; // Of the whole file.
+		u32 files_required;
+		f64 author_time;
+
+		Vector2 start_position;
+		f32     start_angle;
+		u32     on_unlock_dialog;
+
+		UniformGrid::Layout grid;
+
+		Section name;
+		Section walls;
+		Section zones;
+		Section pickups;
+		Section points;
+		Section indices;
+		Section segments;
+		Section grid_cells;
+		Section grid_items;
+		Section bvh_nodes;
+		Section bvh_items;
+		Section bvh_bounds;
+	};
+
+	static std::vector<u8> encode(Level const &level);
+
+	// Checks the header and that every section and index stays in range, throws
+	// std::runtime_error otherwise. The views point into `bytes`.
+	static LevelFile parse(std::span<u8 const> bytes);
+	// Only checks and fills in `header` and `name`, for listing levels without touching the rest.
+	static LevelFile parse_header(std::span<u8 const> bytes);
+
+	Header const                   *header = nullptr;
+	std::string_view               name;
+	std::span<WallRecord const>    walls;
+	std::span<ZoneRecord const>    zones;
+	std::span<PickupRecord const>  pickups;
+	std::span<Vector2 const>       points;
+	std::span<u32 const>           indices;
+	std::span<SegmentRecord const> segments;
+	std::span<u32 const>           grid_cells;
+	std::span<u32 const>           grid_items;
+	std::span<BVH::Node const>     bvh_nodes;
+	std::span<u32 const>           bvh_items;
+	std::span<AABB const>          bvh_bounds;
+};
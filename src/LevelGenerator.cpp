@@ -0,0 +1,255 @@
+#include "LevelGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+#include <raymath.h>
+
+constexpr f32 CELL_SIZE = 160;
+constexpr f32 VERTEX_JITTER = 12;
+constexpr u32 MIN_ZONE_POINTS = 10;
+constexpr u32 MAX_ZONE_POINTS = 24;
+
+struct MazeEdge {
+	u32 a, b; // Grid vertices, x + y * (columns + 1).
+};
+
+struct Maze {
+	u32                   columns, rows;
+	std::vector<MazeEdge> walls;
+	std::vector<MazeEdge> passages; // Carved out, where doors can go.
+};
+
+// mt19937 output is the same everywhere, the standard distributions and std::shuffle aren't.
+static f32 unit(std::mt19937 &rng) { return (rng() >> 8) / 16777216.f; }
+
+static u64 mix(u64 x)
+{
+	x += 0x9e3779b97f4a7c15;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	return x ^ (x >> 31);
+}
+
+// Jittered by a hash of the vertex rather than the RNG, so every wall ending on it agrees.
+static Vector2 vertex_position(Maze const &maze, u32 seed, u32 vertex)
+{
+	u32 const x = vertex % (maze.columns + 1), y = vertex / (maze.columns + 1);
+	u64 const h = mix(mix(seed) ^ vertex);
+	f32 const dx = ((h & 0xffff) / 65535.f - .5f) * 2 * VERTEX_JITTER;
+	f32 const dy = (((h >> 16) & 0xffff) / 65535.f - .5f) * 2 * VERTEX_JITTER;
+	return { x * CELL_SIZE + dx, y * CELL_SIZE + dy };
+}
+
+static Vector2 cell_center(Maze const &maze, u32 cell)
+{
+	return { (cell % maze.columns + .5f) * CELL_SIZE, (cell / maze.columns + .5f) * CELL_SIZE };
+}
+
+// A perfect maze by depth first search: every cell reachable, exactly one way.
+static Maze carve(u32 columns, u32 rows, std::mt19937 &rng)
+{
+	Maze maze = { columns, rows, {}, {} };
+	u32 const stride = columns + 1;
+
+	// Walls on the top and left of each cell, plus the far edges.
+	std::vector<bool> top((rows + 1) * columns, true), left(rows * stride, true);
+	std::vector<bool> visited(columns * rows, false);
+	std::vector<u32>  stack = { 0 };
+	visited[0] = true;
+
+	while (!stack.empty()) {
+		u32 const cell = stack.back();
+		u32 const x = cell % columns, y = cell / columns;
+
+		u32 neighbours[4], count = 0;
+		if (x > 0 && !visited[cell - 1])
+			neighbours[count++] = cell - 1;
+		if (x + 1 < columns && !visited[cell + 1])
+			neighbours[count++] = cell + 1;
+		if (y > 0 && !visited[cell - columns])
+			neighbours[count++] = cell - columns;
+		if (y + 1 < rows && !visited[cell + columns])
+			neighbours[count++] = cell + columns;
+		if (!count) {
+			stack.pop_back();
+			continue;
+		}
+
+		u32 const next = neighbours[rng() % count];
+		u32 const nx = next % columns, ny = next / columns;
+		if (ny == y) {
+			u32 const wx = std::max(x, nx);
+			left[wx + y * stride] = false;
+			maze.passages.push_back({ wx + y * stride, wx + (y + 1) * stride });
+		} else {
+			u32 const wy = std::max(y, ny);
+			top[x + wy * columns] = false;
+			maze.passages.push_back({ x + wy * stride, x + 1 + wy * stride });
+		}
+		visited[next] = true;
+		stack.push_back(next);
+	}
+
+	for (u32 y = 0; y <= rows; y++) {
+		for (u32 x = 0; x < columns; x++) {
+			if (top[x + y * columns])
+				maze.walls.push_back({ x + y * stride, x + 1 + y * stride });
+		}
+	}
+	for (u32 y = 0; y < rows; y++) {
+		for (u32 x = 0; x <= columns; x++) {
+			if (left[x + y * stride])
+				maze.walls.push_back({ x + y * stride, x + (y + 1) * stride });
+		}
+	}
+	return maze;
+}
+
+// Chains wall edges that share a vertex into polylines of up to `max_segments`.
+static std::vector<std::vector<u32>> chain(Maze const &maze, u32 max_walls, u32 max_segments)
+{
+	std::vector<std::vector<u32>> by_vertex((maze.columns + 1) * (maze.rows + 1));
+	for (u32 e = 0; e < maze.walls.size(); e++) {
+		by_vertex[maze.walls[e].a].push_back(e);
+		by_vertex[maze.walls[e].b].push_back(e);
+	}
+
+	std::vector<bool>             used(maze.walls.size(), false);
+	std::vector<std::vector<u32>> lines;
+	for (u32 first = 0; first < maze.walls.size() && lines.size() < max_walls; first++) {
+		if (used[first])
+			continue;
+
+		used[first] = true;
+		std::vector<u32> line = { maze.walls[first].a, maze.walls[first].b };
+		while (line.size() <= max_segments) {
+			u32 const end = line.back();
+			auto const it = std::find_if(by_vertex[end].begin(), by_vertex[end].end(),
+			    [&](u32 e) { return !used[e]; });
+			if (it == by_vertex[end].end())
+				break;
+			used[*it] = true;
+			auto const &edge = maze.walls[*it];
+			line.push_back(edge.a == end ? edge.b : edge.a);
+		}
+		lines.push_back(std::move(line));
+	}
+	return lines;
+}
+
+// Alternating inner and outer radii, so every outline is concave.
+static std::vector<Vector2> star_outline(Vector2 center, std::mt19937 &rng)
+{
+	u32 const points = MIN_ZONE_POINTS + rng() % (MAX_ZONE_POINTS - MIN_ZONE_POINTS + 1);
+
+	std::vector<Vector2> outline;
+	outline.reserve(points);
+	for (u32 i = 0; i < points; i++) {
+		f32 const theta = (i + unit(rng) * .5f) * 2 * PI / points;
+		f32 const radius = CELL_SIZE * (i % 2 ? .15f + unit(rng) * .1f : .35f + unit(rng) * .1f);
+		outline.push_back(
+		    { center.x + std::cos(theta) * radius, center.y + std::sin(theta) * radius });
+	}
+	return outline;
+}
+
+LevelGenerator LevelGenerator::scaled(u32 factor, u32 seed)
+{
+	LevelGenerator generator;
+	generator.seed = seed;
+	generator.walls = 6 * factor;
+	generator.segments_per_wall = 4;
+	generator.zones_per_kind = factor;
+	generator.pickups = 4 * factor;
+	generator.doors = factor;
+	return generator;
+}
+
+Level LevelGenerator::generate(void) const
+{
+	std::mt19937 rng(this->seed);
+
+	// Enough cells that the maze has a wall edge for every segment asked for.
+	u32 const side = std::max<u32>(
+	    2, std::ceil(std::sqrt(static_cast<f64>(this->walls) * this->segments_per_wall)));
+	Maze const maze = carve(side, side, rng);
+	u32 const  cells = side * side;
+
+	Level level("maze-" + std::to_string(this->seed), 0);
+	level.author_time = 0;
+	level.start_position = cell_center(maze, 0);
+	level.start_angle = 0;
+
+	for (auto const &line : chain(maze, this->walls, this->segments_per_wall)) {
+		Level::Wall wall;
+		wall.kind = Level::Wall::Kind::Wall;
+		wall.key_id = 0;
+		wall.first_point = level.points.size();
+		wall.point_count = line.size();
+		for (auto const v : line)
+			level.points.push_back(vertex_position(maze, this->seed, v));
+		level.walls.push_back(wall);
+	}
+
+	auto passages = maze.passages;
+	for (usize i = passages.size(); i > 1; i--)
+		std::swap(passages[i - 1], passages[rng() % i]);
+	u32 const doors = std::min<usize>(this->doors, passages.size());
+	for (u32 i = 0; i < doors; i++) {
+		u8 const key_id = i % 256;
+
+		Level::Wall door;
+		door.kind = Level::Wall::Kind::Door;
+		door.key_id = key_id;
+		door.first_point = level.add_points({ {
+		    vertex_position(maze, this->seed, passages[i].a),
+		    vertex_position(maze, this->seed, passages[i].b),
+		} });
+		door.point_count = 2;
+		level.walls.push_back(door);
+
+		Level::Pickup key;
+		key.kind = Level::Pickup::Kind::Key;
+		key.id = key_id;
+		key.position = cell_center(maze, rng() % cells);
+		level.pickups.push_back(key);
+	}
+
+	for (auto const kind : { Level::Zone::Kind::OneWay, Level::Zone::Kind::Danger,
+	         Level::Zone::Kind::DialogTrigger, Level::Zone::Kind::End }) {
+		for (u32 i = 0; i < this->zones_per_kind; i++) {
+			// The first end zone goes in the far corner, so the whole maze is on the way there.
+			u32 const cell = kind == Level::Zone::Kind::End && i == 0 ? cells - 1 : rng() % cells;
+
+			Level::Zone zone;
+			zone.kind = kind;
+			auto const  outline = star_outline(cell_center(maze, cell), rng);
+			zone.first_point = level.add_points(outline);
+			zone.point_count = outline.size();
+			zone.power = 0;
+			if (kind == Level::Zone::Kind::OneWay) {
+				zone.value.one_way_angle = unit(rng) * 2 * PI;
+				zone.power = .5f + unit(rng) * .5f;
+			} else {
+				zone.value.dialog_index = 0;
+			}
+			zone.triangulate(level.points_of(zone));
+			level.zones.push_back(std::move(zone));
+		}
+	}
+
+	for (u32 i = 0; i < this->pickups; i++) {
+		Level::Pickup file;
+		file.kind = Level::Pickup::Kind::File;
+		file.id = i;
+		file.position = Vector2Add(cell_center(maze, rng() % cells),
+		    { (unit(rng) - .5f) * CELL_SIZE * .4f, (unit(rng) - .5f) * CELL_SIZE * .4f });
+		level.pickups.push_back(file);
+	}
+
+	level.build_collision();
+	return level;
+}
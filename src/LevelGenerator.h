@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Level.h"
+#include "common.h"
+
+// Builds mazes for scaling tests. The same settings always give the same level, so sizes can be
+// compared across runs and machines.
+struct LevelGenerator {
+	u32 seed = 0;
+	u32 walls = 16;
+	u32 segments_per_wall = 4; // At most, walls are cut where the maze turns a dead end.
+	u32 zones_per_kind = 1; // Of OneWay, Danger, DialogTrigger and End each.
+	u32 pickups = 4; // Files.
+	u32 doors = 1; // Each with its key somewhere in the maze.
+
+	// Roughly `factor` times the content of a shipped level.
+	static LevelGenerator scaled(u32 factor, u32 seed = 0);
+
+	// The result is triangulated and has its collision built, like a deserialized level.
+	Level generate(void) const;
+};
@@ -0,0 +1,169 @@
+#include "LevelLayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <raymath.h>
+#include <rlgl.h>
+
+#include "Level.h"
+#include "Profiler.h"
+
+constexpr i32 LAYER_TILE_TEXELS = 512;
+// Texels baked around each tile and left out when drawing it, so filtering at tile edges samples
+// the neighbouring geometry instead of clamping.
+constexpr i32 LAYER_TILE_PADDING = 2;
+constexpr i32 LAYER_TILE_CONTENT = LAYER_TILE_TEXELS - 2 * LAYER_TILE_PADDING;
+constexpr u32 LAYER_MAX_TILES = 48; // 48 MiB, a rotated 1080p view needs up to 36.
+constexpr u32 LAYER_BAKES_PER_FRAME = 4;
+
+void LevelLayer::update(
+    Level const &level, Camera2D const &view, Vector2 screen, ColorPalette const &palette)
+{
+	m_frame++;
+
+	if (&level != m_level) {
+		this->unload();
+		m_level = &level;
+		m_bounds = AABBGrow(AABBFromPoints(level.points), WALL_THICKNESS);
+		m_door_open.assign(level.walls.size(), false);
+	}
+	if (view.zoom != m_scale || std::memcmp(&palette, &m_palette, sizeof(ColorPalette)) != 0) {
+		for (auto &tile : m_tiles)
+			tile.dirty = true;
+		m_scale = view.zoom;
+		m_palette = palette;
+	}
+	for (usize w = 0; w < level.walls.size(); w++) {
+		bool const open = level.walls[w].time_since_trigger != -1;
+		if (open != m_door_open[w]) {
+			m_door_open[w] = open;
+			this->invalidate(
+			    AABBGrow(AABBFromPoints(level.points_of(level.walls[w])), WALL_THICKNESS));
+		}
+	}
+
+	AABB visible = AABBFromCamera(view, screen);
+	m_visible.clear();
+	m_ready = true;
+	if (!CheckCollisionAABBs(visible, m_bounds))
+		return;
+	visible = { Vector2Max(visible.min, m_bounds.min), Vector2Min(visible.max, m_bounds.max) };
+
+	f32 const size = LAYER_TILE_CONTENT / m_scale;
+	i32 const x0 = std::floor(visible.min.x / size), x1 = std::floor(visible.max.x / size);
+	i32 const y0 = std::floor(visible.min.y / size), y1 = std::floor(visible.max.y / size);
+	if (static_cast<u32>((x1 - x0 + 1) * (y1 - y0 + 1)) > LAYER_MAX_TILES) {
+		m_ready = false;
+		return;
+	}
+
+	u32 bakes = 0;
+	for (i32 y = y0; y <= y1; y++) {
+		for (i32 x = x0; x <= x1; x++) {
+			Tile *tile = this->find(x, y);
+			if (!tile && m_tiles.size() < LAYER_MAX_TILES) {
+				RenderTexture2D texture = LoadRenderTexture(LAYER_TILE_TEXELS, LAYER_TILE_TEXELS);
+				SetTextureFilter(texture.texture, TEXTURE_FILTER_BILINEAR);
+				tile = &m_tiles.emplace_back(Tile { x, y, texture, true, 0 });
+			} else if (!tile) {
+				// Reuse the least recently seen tile. Everything in view fits under the cap, so
+				// there is always one that isn't.
+				tile = &*std::min_element(m_tiles.begin(), m_tiles.end(),
+				    [](Tile const &a, Tile const &b) { return a.last_used < b.last_used; });
+				tile->x = x;
+				tile->y = y;
+				tile->dirty = true;
+			}
+
+			tile->last_used = m_frame;
+			if (tile->dirty) {
+				if (bakes++ < LAYER_BAKES_PER_FRAME) {
+					this->bake(*tile, level);
+					tile->dirty = false;
+				} else {
+					m_ready = false;
+				}
+			}
+			m_visible.push_back(tile - m_tiles.data());
+		}
+	}
+}
+
+bool LevelLayer::draw(void) const
+{
+	if (!m_ready)
+		return false;
+
+	f32 const       size = LAYER_TILE_CONTENT / m_scale;
+	Rectangle const source = { LAYER_TILE_PADDING, LAYER_TILE_PADDING, LAYER_TILE_CONTENT,
+		-LAYER_TILE_CONTENT }; // Render textures are upside down.
+
+	// Tiles are baked premultiplied, blending them that way keeps filtered edges from darkening.
+	BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+	for (auto const i : m_visible) {
+		auto const &tile = m_tiles[i];
+		DrawTexturePro(tile.texture.texture, source, { tile.x * size, tile.y * size, size, size },
+		    { 0, 0 }, 0, WHITE);
+	}
+	EndBlendMode();
+	return true;
+}
+
+void LevelLayer::unload(void)
+{
+	for (auto const &tile : m_tiles)
+		UnloadRenderTexture(tile.texture);
+	m_tiles.clear();
+	m_visible.clear();
+	m_door_open.clear();
+	m_level = nullptr;
+	m_ready = false;
+}
+
+LevelLayer::Tile *LevelLayer::find(i32 x, i32 y)
+{
+	for (auto &tile : m_tiles) {
+		if (tile.x == x && tile.y == y)
+			return &tile;
+	}
+	return nullptr;
+}
+
+AABB LevelLayer::tile_bounds(i32 x, i32 y) const
+{
+	f32 const size = LAYER_TILE_CONTENT / m_scale;
+	return { { x * size, y * size }, { (x + 1) * size, (y + 1) * size } };
+}
+
+void LevelLayer::invalidate(AABB const &box)
+{
+	for (auto &tile : m_tiles) {
+		if (CheckCollisionAABBs(box, this->tile_bounds(tile.x, tile.y)))
+			tile.dirty = true;
+	}
+}
+
+void LevelLayer::bake(Tile &tile, Level const &level) const
+{
+	PROFILE_SCOPE("layer_bake");
+
+	Camera2D camera {};
+	camera.target = Vector2Subtract(this->tile_bounds(tile.x, tile.y).min,
+	    { LAYER_TILE_PADDING / m_scale, LAYER_TILE_PADDING / m_scale });
+	camera.zoom = m_scale;
+
+	BeginTextureMode(tile.texture);
+	ClearBackground(BLANK);
+	// Antialiased wall edges are partly transparent, accumulate alpha so the tile ends up
+	// premultiplied rather than squaring it.
+	rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE,
+	    RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+	BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+	BeginMode2D(camera);
+	level.mesh.draw(level, m_palette, this->tile_bounds(tile.x, tile.y));
+	EndMode2D();
+	EndBlendMode();
+	EndTextureMode();
+}
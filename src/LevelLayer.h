@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib.h>
+
+#include "Color.h"
+#include "GameMath.h"
+#include "common.h"
+
+struct Level;
+
+// The static part of a level (zones, walls and closed doors) baked into world-space tiles, so a
+// frame composites a few textured quads instead of drawing every mesh. Tiles are baked as they
+// come into view, at most LAYER_MAX_TILES stay alive, and a door opening or closing only rebakes
+// the tiles it crosses.
+struct LevelLayer {
+	// Bakes what `view` shows of `level`, a few tiles a frame. Must run outside any BeginMode2D()
+	// or texture mode, since baking switches render targets.
+	void update(Level const &level, Camera2D const &view, Vector2 screen,
+	    ColorPalette const &palette);
+	// Composites the tiles update() found in view, inside BeginMode2D(view). Returns false when
+	// some of them aren't baked yet, or there are more than the cap, the caller draws the meshes
+	// instead then.
+	bool draw(void) const;
+
+	void unload(void);
+	// Drops the tiles if they belong to `level`, for LevelCatalogue::on_evict.
+	void forget(Level const &level)
+	{
+		if (&level == m_level)
+			this->unload();
+	}
+
+private:
+	struct Tile {
+		i32             x, y; // In tiles from the world origin.
+		RenderTexture2D texture;
+		bool            dirty;
+		u64             last_used; // Frame it was last in view.
+	};
+
+	Tile *find(i32 x, i32 y);
+	AABB  tile_bounds(i32 x, i32 y) const;
+	void  invalidate(AABB const &box);
+	void  bake(Tile &tile, Level const &level) const;
+
+	Level const      *m_level = nullptr;
+	ColorPalette      m_palette {};
+	f32               m_scale = 0; // Texels per world unit, the camera zoom at bake time.
+	AABB              m_bounds {}; // Of the level's geometry, no tiles are made outside it.
+	std::vector<bool> m_door_open; // Per wall, as last baked.
+	std::vector<Tile> m_tiles;
+	std::vector<u32>  m_visible; // Into m_tiles, from the last update().
+	bool              m_ready = false;
+	u64               m_frame = 0;
+};
@@ -0,0 +1,255 @@
+#include "LevelMesh.h"
+
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include "Color.h"
+#include "Counters.h"
+#include "GameMath.h"
+#include "Level.h"
+
+constexpr auto WALL_JOINT_SEGMENTS = 16;
+constexpr f32  MESH_CHUNK_SIZE = 1024; // World units, a chunk is about a screen at zoom 2.
+constexpr f32  PICKUP_GRID_CELL_SIZE = 256;
+
+struct MeshBuilder {
+	LevelMesh::Group &out;
+
+	std::vector<float> vertices {};
+	std::vector<u16>   indices {};
+
+	// Starts a new mesh if `count` more vertices would overflow the u16 index range.
+	u16 reserve(usize count)
+	{
+		if (vertices.size() / 3 + count > std::numeric_limits<u16>::max())
+			flush();
+		return static_cast<u16>(vertices.size() / 3);
+	}
+
+	void vertex(Vector2 p)
+	{
+		vertices.push_back(p.x);
+		vertices.push_back(p.y);
+		vertices.push_back(0);
+	}
+
+	void triangle(u16 a, u16 b, u16 c)
+	{
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+
+	void quad(Vector2 a, Vector2 b, float half_width)
+	{
+		auto dir = Vector2Subtract(b, a);
+		if (dir.x == 0 && dir.y == 0)
+			return;
+		auto n = Vector2Scale(Vector2Normalize(Vector2Perpendicular(dir)), half_width);
+
+		u16 base = reserve(4);
+		vertex(Vector2Add(a, n));
+		vertex(Vector2Subtract(a, n));
+		vertex(Vector2Subtract(b, n));
+		vertex(Vector2Add(b, n));
+		triangle(base, base + 1, base + 2);
+		triangle(base, base + 2, base + 3);
+	}
+
+	void circle(Vector2 center, float radius)
+	{
+		u16 base = reserve(WALL_JOINT_SEGMENTS + 1);
+		vertex(center);
+		for (int i = 0; i < WALL_JOINT_SEGMENTS; i++) {
+			float theta = 2 * PI * i / WALL_JOINT_SEGMENTS;
+			vertex({ center.x + std::cos(theta) * radius, center.y + std::sin(theta) * radius });
+			triangle(base, base + 1 + i, base + 1 + (i + 1) % WALL_JOINT_SEGMENTS);
+		}
+	}
+
+	// Capsule strip: one quad per segment and a single rounded cap per joint.
+	void polyline(std::span<Vector2 const> points, float thickness)
+	{
+		for (usize i = 0; i + 1 < points.size(); i++)
+			quad(points[i], points[i + 1], thickness / 2);
+		for (auto const &point : points)
+			circle(point, thickness / 2);
+	}
+
+	void polygon(std::span<Vector2 const> points, std::vector<u32> const &tris)
+	{
+		// Triangulated polygons are small, so emit them unshared and keep the split logic simple.
+		for (usize i = 0; i + 2 < tris.size(); i += 3) {
+			u16 base = reserve(3);
+			vertex(points[tris[i]]);
+			vertex(points[tris[i + 1]]);
+			vertex(points[tris[i + 2]]);
+			triangle(base, base + 1, base + 2);
+		}
+	}
+
+	void flush(void)
+	{
+		if (indices.empty())
+			return;
+
+		Mesh mesh {};
+		mesh.vertexCount = static_cast<int>(vertices.size() / 3);
+		mesh.triangleCount = static_cast<int>(indices.size() / 3);
+		// UnloadMesh() frees these with raylib's allocator, and DrawMesh() needs `indices` to
+		// stay set to pick the indexed path, so both are handed over to raylib.
+		mesh.vertices = static_cast<float *>(MemAlloc(vertices.size() * sizeof(float)));
+		mesh.indices = static_cast<unsigned short *>(MemAlloc(indices.size() * sizeof(u16)));
+		std::copy(vertices.begin(), vertices.end(), mesh.vertices);
+		std::copy(indices.begin(), indices.end(), mesh.indices);
+		UploadMesh(&mesh, false);
+		out.push_back(mesh);
+
+		vertices.clear();
+		indices.clear();
+	}
+};
+
+void LevelMesh::build(Level const &level)
+{
+	this->unload();
+	bool const sdf_walls = this->wall_sdf.build(level);
+
+	// Walls and zones go in the chunk their bounds are centred in. Ordered by chunk, so building
+	// the same level always gives the same meshes.
+	struct Bucket {
+		AABB             bounds;
+		std::vector<u32> walls, zones;
+	};
+	std::map<std::pair<i32, i32>, Bucket> buckets;
+	auto const bucket = [&](AABB const &box) -> Bucket & {
+		Vector2 const center = Vector2Scale(Vector2Add(box.min, box.max), .5f);
+		std::pair<i32, i32> const key = { static_cast<i32>(std::floor(center.x / MESH_CHUNK_SIZE)),
+			static_cast<i32>(std::floor(center.y / MESH_CHUNK_SIZE)) };
+		auto const [it, inserted] = buckets.try_emplace(key, Bucket { box, {}, {} });
+		if (!inserted)
+			it->second.bounds = AABBUnion(it->second.bounds, box);
+		return it->second;
+	};
+
+	for (u32 z = 0; z < level.zones.size(); z++) {
+		auto const &zone = level.zones[z];
+		if (zone.kind == Level::Zone::Kind::OneWay || zone.kind == Level::Zone::Kind::Danger)
+			bucket(zone.bounds).zones.push_back(z);
+	}
+
+	this->doors.resize(level.walls.size());
+	for (u32 w = 0; w < level.walls.size(); w++) {
+		auto const &wall = level.walls[w];
+		AABB const  bounds = AABBGrow(AABBFromPoints(level.points_of(wall)), WALL_THICKNESS / 2.f);
+		if (wall.kind == Level::Wall::Kind::Door) {
+			this->doors[w].bounds = bounds;
+			MeshBuilder door { this->doors[w].meshes };
+			door.polyline(level.points_of(wall), WALL_THICKNESS);
+			door.flush();
+		} else {
+			bucket(bounds).walls.push_back(w);
+		}
+	}
+
+	// Builders hold on to their chunk, so the vector must not grow under them.
+	this->chunks.reserve(buckets.size());
+	for (auto const &[key, items] : buckets) {
+		auto       &chunk = this->chunks.emplace_back(Chunk { items.bounds, {}, {}, {} });
+		MeshBuilder walls { chunk.walls };
+		MeshBuilder one_way { chunk.one_way_zones }, danger { chunk.danger_zones };
+		for (auto const z : items.zones) {
+			auto const &zone = level.zones[z];
+			auto       &builder = zone.kind == Level::Zone::Kind::OneWay ? one_way : danger;
+			builder.polygon(level.points_of(zone), zone.indices);
+		}
+		if (!sdf_walls) {
+			for (auto const w : items.walls)
+				walls.polyline(level.points_of(level.walls[w]), WALL_THICKNESS);
+		}
+		one_way.flush();
+		danger.flush();
+		walls.flush();
+	}
+
+	std::vector<AABB> pickups;
+	pickups.reserve(level.pickups.size());
+	for (auto const &pickup : level.pickups)
+		pickups.push_back(AABBFromSegment(pickup.position, pickup.position, PICKUP_RADIUS));
+	this->pickup_grid.build(pickups, PICKUP_GRID_CELL_SIZE);
+
+	m_material = LoadMaterialDefault();
+	m_built = true;
+}
+
+void LevelMesh::unload(void)
+{
+	for (auto const &chunk : this->chunks) {
+		for (auto const *group : { &chunk.walls, &chunk.one_way_zones, &chunk.danger_zones }) {
+			for (auto const &mesh : *group)
+				UnloadMesh(mesh);
+		}
+	}
+	this->chunks.clear();
+	for (auto const &door : this->doors) {
+		for (auto const &mesh : door.meshes)
+			UnloadMesh(mesh);
+	}
+	this->doors.clear();
+	this->wall_sdf.unload();
+	if (m_built)
+		UnloadMaterial(m_material);
+	m_material = {};
+	m_built = false;
+}
+
+static void draw_group(LevelMesh::Group const &group, Material const &material, Color color)
+{
+	material.maps[MATERIAL_MAP_DIFFUSE].color = color;
+	for (auto const &mesh : group) {
+		DrawMesh(mesh, material, MatrixIdentity());
+		g_counters.add(Counter::Triangles, mesh.triangleCount);
+	}
+}
+
+void LevelMesh::draw(Level const &level, ColorPalette const &palette, AABB const &view) const
+{
+	// Meshes bypass the immediate-mode batch, flush it so earlier draws stay underneath.
+	rlDrawRenderBatchActive();
+	// The 2D projection flips Y, which would make the front faces cull away.
+	rlDisableBackfaceCulling();
+
+	// Layer by layer over all chunks, so no zone ends up over a neighbouring chunk's walls.
+	usize drawn = 0;
+	for (auto const &chunk : this->chunks) {
+		if (CheckCollisionAABBs(chunk.bounds, view)) {
+			draw_group(chunk.one_way_zones, m_material, palette.one_way_zone_background);
+			drawn++;
+		}
+	}
+	g_counters.add(Counter::ChunksDrawn, drawn);
+	g_counters.add(Counter::ChunksCulled, this->chunks.size() - drawn);
+
+	for (auto const &chunk : this->chunks) {
+		if (CheckCollisionAABBs(chunk.bounds, view))
+			draw_group(chunk.danger_zones, m_material, palette.danger_zone_background);
+	}
+	if (!this->wall_sdf.draw(view, palette.wall)) {
+		for (auto const &chunk : this->chunks) {
+			if (CheckCollisionAABBs(chunk.bounds, view))
+				draw_group(chunk.walls, m_material, palette.wall);
+		}
+	}
+	for (usize i = 0; i < this->doors.size(); i++) {
+		auto const &door = this->doors[i];
+		if (level.walls[i].time_since_trigger == -1 && CheckCollisionAABBs(door.bounds, view))
+			draw_group(door.meshes, m_material, palette.key_door);
+	}
+
+	rlEnableBackfaceCulling();
+}
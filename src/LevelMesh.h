@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib.h>
+
+#include "GameMath.h"
+#include "UniformGrid.h"
+#include "WallSdf.h"
+#include "common.h"
+
+struct Level;
+struct ColorPalette;
+
+// Static level geometry baked into GPU meshes, one set per color layer, so drawing a level
+// costs a handful of calls no matter how many segments it has. The meshes are split into chunks
+// of the world so draw() can skip the ones out of view. Plain walls go through WallSdf where the
+// GPU takes it, and only get meshes otherwise. Doors get meshes of their own so each one can be
+// hidden once it has been triggered.
+struct LevelMesh {
+	// raylib indexes meshes with u16, so a layer is split over as many meshes as it needs.
+	using Group = std::vector<Mesh>;
+
+	struct Chunk {
+		AABB  bounds; // Of everything in it, which can reach past the chunk's own square.
+		Group walls;
+		Group one_way_zones;
+		Group danger_zones;
+	};
+
+	struct Door {
+		AABB  bounds;
+		Group meshes;
+	};
+
+	std::vector<Chunk> chunks;
+	std::vector<Door>  doors; // Indexed like Level::walls, empty for plain walls.
+	WallSdf            wall_sdf;
+	UniformGrid        pickup_grid; // Over Level::pickups, for culling them in Level::render().
+
+	bool is_built(void) const { return m_built; }
+
+	// Both need a GL context, so meshes are built on first draw rather than in deserialize().
+	void build(Level const &level);
+	void unload(void);
+
+	// Submits the chunks and closed doors overlapping `view`, a world-space box.
+	void draw(Level const &level, ColorPalette const &palette, AABB const &view) const;
+
+private:
+	Material m_material {}; // Default shader, draw() sets the diffuse color per group.
+	bool     m_built = false;
+};
@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+// Kept free of raylib.h, windows.h clashes with several of its names.
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BYTERACER_MMAP
+#endif
+
+MappedFile::MappedFile(std::filesystem::path const &path)
+{
+#if defined(_WIN32)
+	m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	    FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		m_file = nullptr;
+		throw std::runtime_error("Failed to open file for reading.");
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(m_file, &size);
+	m_size = static_cast<usize>(size.QuadPart);
+	if (m_size) {
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping)
+			m_data = static_cast<u8 const *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_data) {
+			release();
+			throw std::runtime_error("Failed to map file.");
+		}
+		m_mapped = true;
+	}
+#elif defined(BYTERACER_MMAP)
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open file for reading.");
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		throw std::runtime_error("Failed to stat file.");
+	}
+	m_size = static_cast<usize>(st.st_size);
+	if (m_size) {
+		void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map file.");
+		}
+		m_data = static_cast<u8 const *>(data);
+		m_mapped = true;
+	}
+	// The mapping keeps its own reference to the file.
+	close(fd);
+#else
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		throw std::runtime_error("Failed to open file for reading.");
+	m_buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	release();
+	m_data = std::exchange(other.m_data, nullptr);
+	m_size = std::exchange(other.m_size, 0);
+	m_mapped = std::exchange(other.m_mapped, false);
+	m_buffer = std::move(other.m_buffer);
+#ifdef _WIN32
+	m_file = std::exchange(other.m_file, nullptr);
+	m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+	return *this;
+}
+
+void MappedFile::release(void)
+{
+#if defined(_WIN32)
+	if (m_mapped)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+	m_mapping = m_file = nullptr;
+#elif defined(BYTERACER_MMAP)
+	if (m_mapped)
+		munmap(const_cast<u8 *>(m_data), m_size);
+#endif
+	m_buffer.clear();
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "common.h"
+
+// Read-only view of a whole file, memory-mapped where the platform allows it and read into a
+// buffer otherwise. The bytes stay valid for as long as the object lives.
+struct MappedFile {
+	MappedFile() = default;
+	explicit MappedFile(std::filesystem::path const &path);
+	~MappedFile();
+
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	std::span<u8 const> bytes(void) const { return { m_data, m_size }; }
+
+private:
+	void release(void);
+
+	u8 const *m_data = nullptr;
+	usize     m_size = 0;
+	bool      m_mapped = false;
+
+	std::vector<u8> m_buffer; // Used where mapping isn't available.
+#ifdef _WIN32
+	void *m_file = nullptr;
+	void *m_mapping = nullptr;
+#endif
+};
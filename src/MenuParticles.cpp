@@ -0,0 +1,71 @@
+#include "MenuParticles.h"
+
+#include <algorithm>
+
+#include <rlgl.h>
+
+constexpr f32   MENU_PARTICLE_WIDTH = 20;
+constexpr f32   MENU_PARTICLE_HEIGHT = 2;
+constexpr f32   MENU_PARTICLE_MIN_SPEED = 500;
+constexpr f32   MENU_PARTICLE_MAX_SPEED = 700;
+constexpr usize MENU_PARTICLE_BLOCK = 1024; // Quads checked against the batch limit at a time.
+
+void MenuParticles::spawn(usize count, f32 width, f32 height, u32 seed)
+{
+	m_rng = seed ? seed : 1;
+	m_x.resize(count);
+	m_y.resize(count);
+	m_speed.resize(count);
+	for (usize i = 0; i < count; i++) {
+		m_x[i] = this->random(0, width);
+		m_y[i] = this->random(0, height);
+		m_speed[i] = this->random(MENU_PARTICLE_MIN_SPEED, MENU_PARTICLE_MAX_SPEED);
+	}
+}
+
+void MenuParticles::update(f32 dt, f32 width, f32 height)
+{
+	usize const count = m_x.size();
+	f32 *const  x = m_x.data();
+	f32 const  *speed = m_speed.data();
+	for (usize i = 0; i < count; i++)
+		x[i] -= dt * speed[i];
+
+	// Only a handful wrap each frame, so this stays out of the loop above.
+	for (usize i = 0; i < count; i++) {
+		if (x[i] < 0) {
+			x[i] += width;
+			m_y[i] = this->random(0, height);
+			m_speed[i] = this->random(MENU_PARTICLE_MIN_SPEED, MENU_PARTICLE_MAX_SPEED);
+		}
+	}
+}
+
+void MenuParticles::draw(Color color) const
+{
+	// Untextured quads all land in the same batch, which raylib draws in one call as long as
+	// it has room, so only check the limit once per block.
+	for (usize first = 0; first < m_x.size(); first += MENU_PARTICLE_BLOCK) {
+		usize const last = std::min(first + MENU_PARTICLE_BLOCK, m_x.size());
+		rlCheckRenderBatchLimit(4 * (last - first));
+		rlBegin(RL_QUADS);
+		rlColor4ub(color.r, color.g, color.b, color.a);
+		for (usize i = first; i < last; i++) {
+			// Whole pixels, like DrawRectangle(), so the thin streaks don't shimmer.
+			f32 const x = static_cast<i32>(m_x[i]), y = static_cast<i32>(m_y[i]);
+			rlVertex2f(x, y);
+			rlVertex2f(x, y + MENU_PARTICLE_HEIGHT);
+			rlVertex2f(x + MENU_PARTICLE_WIDTH, y + MENU_PARTICLE_HEIGHT);
+			rlVertex2f(x + MENU_PARTICLE_WIDTH, y);
+		}
+		rlEnd();
+	}
+}
+
+f32 MenuParticles::random(f32 min, f32 max)
+{
+	m_rng ^= m_rng << 13;
+	m_rng ^= m_rng >> 17;
+	m_rng ^= m_rng << 5;
+	return min + (m_rng >> 8) * (1.f / (1 << 24)) * (max - min);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib.h>
+
+#include "common.h"
+
+// The streaks drifting left behind the level map. Stored as parallel arrays so update() is a
+// plain loop the compiler can vectorise, drawn as one run of quads through the rlgl batch, and
+// respawned from a local xorshift generator, so a frame neither allocates nor calls into raylib
+// per particle.
+struct MenuParticles {
+	void spawn(usize count, f32 width, f32 height, u32 seed);
+	// Moves everything left, wrapping what leaves the screen back in on the right.
+	void update(f32 dt, f32 width, f32 height);
+	void draw(Color color) const;
+
+private:
+	f32 random(f32 min, f32 max); // Uniform in [min, max).
+
+	std::vector<f32> m_x, m_y, m_speed;
+	u32              m_rng = 1; // xorshift32 state, never 0.
+};
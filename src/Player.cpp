@@ -5,55 +5,58 @@
 #include <raylib.h>
 #include <raymath.h>
 
+#include "Counters.h"
 #include "GameMath.h"
-#include "GameState.h"
 #include "Level.h"
+#include "SegmentKernel.h"
 
-void Player::render(void)
-{
-	for (auto const &trailer : this->trail) {
-		auto const &pickup = *trailer.ptr;
-		float       radius = PICKUP_RADIUS;
-		if (pickup.time_since_pickup != -1) {
-			if (pickup.time_since_pickup <= .3) {
-				radius *= pickup.time_since_pickup / .3;
-			}
-		}
-		trailer.ptr->render(
-		    trailer.position, radius, atan2(trailer.direction.y, trailer.direction.x) * RAD2DEG);
-	}
+constexpr auto MAX_SWEEP_ITERATIONS = 4;
+// Added to the radius given to CollideCircleSegments(), which has to overestimate, see there.
+constexpr float SEGMENT_KERNEL_SLACK = .5f;
+// Below this many nearby segments, filtering them first costs more than testing them all.
+constexpr usize SEGMENT_KERNEL_MIN = 8;
 
-	g_gs.render_texture(
-	    this->position, 0, this->angle * RAD2DEG + 90, PLAYER_RADIUS, g_gs.palette.primary);
+void Player::snapshot(void)
+{
+	this->previous_position = this->position;
+	this->previous_angle = this->angle;
+	for (auto &trailer : this->trail)
+		trailer.previous_position = trailer.position;
 }
 
-void Player::update(double dt)
+void Player::update(Level &level, InputState input, double dt)
 {
+	this->snapshot();
+
 	{ // Player controller
 		constexpr auto PLAYER_VELOCITY_ADDITION = PLAYER_SPEED;
 
-		if (!g_gs.completion_time) {
-			if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) {
-				this->velocity.x += std::cos(this->angle) * PLAYER_VELOCITY_ADDITION * dt;
-				this->velocity.y += std::sin(this->angle) * PLAYER_VELOCITY_ADDITION * dt;
-			}
-			if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) {
-				this->velocity.x += std::cos(this->angle) * -PLAYER_VELOCITY_ADDITION * dt;
-				this->velocity.y += std::sin(this->angle) * -PLAYER_VELOCITY_ADDITION * dt;
-			}
-			if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) {
-				this->angle -= PLAYER_TURNING_SPEED * dt;
-			}
-			if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) {
-				this->angle += PLAYER_TURNING_SPEED * dt;
-			}
+		// Input is already empty once the level is completed, see Simulation::tick().
+		if (input.held(InputState::Thrust)) {
+			this->velocity.x += std::cos(this->angle) * PLAYER_VELOCITY_ADDITION * dt;
+			this->velocity.y += std::sin(this->angle) * PLAYER_VELOCITY_ADDITION * dt;
+		}
+		if (input.held(InputState::Reverse)) {
+			this->velocity.x += std::cos(this->angle) * -PLAYER_VELOCITY_ADDITION * dt;
+			this->velocity.y += std::sin(this->angle) * -PLAYER_VELOCITY_ADDITION * dt;
+		}
+		if (input.held(InputState::Left)) {
+			this->angle -= PLAYER_TURNING_SPEED * dt;
+		}
+		if (input.held(InputState::Right)) {
+			this->angle += PLAYER_TURNING_SPEED * dt;
 		}
 
-		for (auto const &zone : g_gs.level()->zones) {
+		constexpr float zone_radius = PLAYER_RADIUS * .85;
+		this->nearby_zones.clear();
+		level.zone_bvh.query(
+		    AABBFromSegment(this->position, this->position, zone_radius), this->nearby_zones);
+		for (auto const z : this->nearby_zones) {
+			auto const &zone = level.zones[z];
 			if (zone.kind != Level::Zone::Kind::OneWay)
 				continue;
 
-			if (CheckCollisionCirclePoly(g_gs.player.position, PLAYER_RADIUS * .85, zone.points)) {
+			if (CheckCollisionCirclePoly(this->position, zone_radius, level.points_of(zone))) {
 				this->velocity.x += std::cos(zone.value.one_way_angle) * PLAYER_VELOCITY_ADDITION
 				    * zone.power * dt;
 				this->velocity.y += std::sin(zone.value.one_way_angle) * PLAYER_VELOCITY_ADDITION
@@ -72,7 +75,7 @@ void Player::update(double dt)
 			};
 		}
 
-		this->position = Vector2Add(this->position, Vector2Scale(this->velocity, dt));
+		this->sweep(level, dt);
 
 		float friction_factor = std::pow(PLAYER_FRICTION, dt);
 		this->velocity.x *= friction_factor;
@@ -80,91 +83,43 @@ void Player::update(double dt)
 	}
 
 	{ // Collision detection and response
-		for (auto &wall : g_gs.level()->walls) {
+		for (auto &wall : level.walls) {
 			if (wall.time_since_trigger != -1)
 				wall.time_since_trigger += dt;
+		}
 
-			for (size_t i = 0; i < wall.points.size() - 1; ++i) {
-				Vector2 wall_start = wall.points.at(i);
-				Vector2 wall_end = wall.points.at(i + 1);
-				Vector2 wall_dir = Vector2Subtract(wall_end, wall_start);
-
-				Vector2 to_player = Vector2Subtract(this->position, wall_start);
-				float   t = Vector2DotProduct(to_player, wall_dir)
-				    / Vector2DotProduct(wall_dir, wall_dir);
-				t = std::clamp(t, 0.0f, 1.0f);
-				Vector2 closest_point = Vector2Add(wall_start, Vector2Scale(wall_dir, t));
-
-				float distance = Vector2Length(Vector2Subtract(this->position, closest_point));
-				float radius = PLAYER_RADIUS * .85 + (WALL_THICKNESS / 2);
-
-				Vector2 start_to_player = Vector2Subtract(this->position, wall_start);
-				float   start_distance = Vector2Length(start_to_player);
-				if (start_distance < radius + WALL_THICKNESS / 2) {
-					Vector2 start_normal = Vector2Normalize(start_to_player);
-					this->velocity = Vector2Scale(
-					    Vector2Reflect(this->velocity, start_normal), BOUNCE_SLOWDOWN);
-					this->position = Vector2Add(wall_start,
-					    Vector2Scale(start_normal, radius + 0.15f + WALL_THICKNESS / 2));
-				}
+		// Endpoint checks reach the furthest, and pushes below can move us up to a radius more.
+		constexpr float endpoint_reach = PLAYER_RADIUS * .85 + WALL_THICKNESS;
+		constexpr float reach = endpoint_reach + PLAYER_RADIUS;
+		this->nearby_segments.clear();
+		level.wall_grid.query(
+		    AABBFromSegment(this->previous_position, this->position, reach), this->nearby_segments);
+		g_counters.add(Counter::SegmentTests, this->nearby_segments.size());
 
-				Vector2 end_to_player = Vector2Subtract(this->position, wall_end);
-				float   end_distance = Vector2Length(end_to_player);
-				if (end_distance < radius + WALL_THICKNESS / 2) {
-					Vector2 end_normal = Vector2Normalize(end_to_player);
-					this->velocity
-					    = Vector2Scale(Vector2Reflect(this->velocity, end_normal), BOUNCE_SLOWDOWN);
-					this->position = Vector2Add(
-					    wall_end, Vector2Scale(end_normal, radius + 0.15f + WALL_THICKNESS / 2));
-				}
+		// Only segments the kernel finds within reach can push us. Every push moves the player,
+		// so the segments after it are tested again from the new position, in the same order the
+		// plain loop over all of them would have gone.
+		std::span<u32 const> remaining = this->nearby_segments;
+		if (remaining.size() < SEGMENT_KERNEL_MIN) {
+			for (auto const id : remaining)
+				this->collide_segment(level, id);
+			remaining = {};
+		}
+		while (!remaining.empty()) {
+			this->segment_hits.clear();
+			CollideCircleSegments(this->position, endpoint_reach + SEGMENT_KERNEL_SLACK,
+			    level.segments, remaining, this->segment_hits);
 
-				if (distance < radius) {
-					if (wall.kind == Level::Wall::Kind::Door) {
-						auto should_cont = false;
-						for (usize i = 0; i < this->trail.size(); i++) {
-							auto &item = this->trail[i];
-							if (item.ptr->id == wall.key_id) {
-								should_cont = true;
-								wall.time_since_trigger = 0;
-								trail_remove(i);
-							}
-						}
-						if (should_cont || wall.time_since_trigger != -1)
-							continue;
-					}
-
-					Vector2 wall_normal = Vector2Normalize(Vector2Perpendicular(wall_dir));
-
-					if (Vector2DotProduct(
-					        Vector2Subtract(this->position, closest_point), wall_normal)
-					    < 0) {
-						wall_normal = Vector2Negate(wall_normal);
-					}
-
-					float angle_cos
-					    = Vector2DotProduct(Vector2Normalize(this->velocity), wall_normal);
-					float angle_degrees = std::acos(angle_cos) * RAD2DEG;
-
-					float initial_speed = Vector2Length(this->velocity);
-
-					if (initial_speed >= PLAYER_SPEED * 0.2)
-						PlaySound(g_gs.wall_hit);
-
-					constexpr float BOUNCE_ANGLE_THRESHOLD = 20.0f;
-					if (angle_degrees > BOUNCE_ANGLE_THRESHOLD) {
-						constexpr float bounce_factor = BOUNCE_SLOWDOWN;
-						this->velocity = Vector2Scale(
-						    Vector2Reflect(this->velocity, wall_normal), bounce_factor);
-					} else {
-						Vector2 wall_tangent = Vector2Normalize(wall_dir);
-						this->velocity = Vector2Scale(wall_tangent, initial_speed);
-					}
-
-					float correction_offset = radius + 0.15f;
-					this->position
-					    = Vector2Add(closest_point, Vector2Scale(wall_normal, correction_offset));
+			usize next = remaining.size();
+			for (auto const &hit : this->segment_hits) {
+				Vector2 const before = this->position;
+				this->collide_segment(level, remaining[hit.item]);
+				if (this->position.x != before.x || this->position.y != before.y) {
+					next = hit.item + 1;
+					break;
 				}
 			}
+			remaining = remaining.subspan(next);
 		}
 	}
 
@@ -187,6 +142,150 @@ void Player::update(double dt)
 	}
 }
 
+void Player::sweep(Level &level, double dt)
+{
+	constexpr float radius = PLAYER_RADIUS * .85 + (WALL_THICKNESS / 2);
+
+	float remaining = 1;
+	for (int iteration = 0; iteration < MAX_SWEEP_ITERATIONS && remaining > 0; iteration++) {
+		Vector2 const motion = Vector2Scale(this->velocity, dt * remaining);
+		Vector2 const target = Vector2Add(this->position, motion);
+
+		this->nearby_segments.clear();
+		level.wall_grid.query(
+		    AABBFromSegment(this->position, target, radius), this->nearby_segments);
+		g_counters.add(Counter::SegmentTests, this->nearby_segments.size());
+
+		// Anything the motion can touch is within reach of its midpoint.
+		this->segment_hits.clear();
+		if (this->nearby_segments.size() < SEGMENT_KERNEL_MIN) {
+			for (u32 i = 0; i < this->nearby_segments.size(); i++)
+				this->segment_hits.push_back({ i, 0, 0 });
+		} else {
+			CollideCircleSegments(Vector2Add(this->position, Vector2Scale(motion, .5f)),
+			    radius + Vector2Length(motion) / 2 + SEGMENT_KERNEL_SLACK, level.segments,
+			    this->nearby_segments, this->segment_hits);
+		}
+
+		float   toi = 2;
+		Vector2 normal;
+		u32     hit;
+		for (auto const &candidate : this->segment_hits) {
+			u32 const id = this->nearby_segments[candidate.item];
+			float     t;
+			Vector2 n;
+			if (SweepCircleCapsule(this->position, target, level.segments.get(id), radius, t, n)
+			    && t < toi) {
+				toi = t;
+				normal = n;
+				hit = id;
+			}
+		}
+
+		if (toi > 1) {
+			this->position = target;
+			return;
+		}
+
+		this->position = Vector2Add(this->position, Vector2Scale(motion, toi));
+		remaining *= 1 - toi;
+
+		this->hit_wall(level, level.segments.wall[hit],
+		    Vector2Subtract(this->position, Vector2Scale(normal, radius)), normal,
+		    { level.segments.dir_x[hit], level.segments.dir_y[hit] }, radius);
+	}
+}
+
+void Player::collide_segment(Level &level, u32 id)
+{
+	u32 const w = level.segments.wall[id];
+	auto     &wall = level.walls[w];
+	if (wall.time_since_trigger != -1)
+		return; // Door opened by an earlier segment this frame.
+
+	Segment const segment = level.segments.get(id);
+	Vector2       wall_start = segment.start;
+	Vector2       wall_dir = segment.dir;
+	Vector2       wall_end = Vector2Add(wall_start, wall_dir);
+
+	Vector2 to_player = Vector2Subtract(this->position, wall_start);
+	float   t = Vector2DotProduct(to_player, wall_dir) * segment.inv_length_sq;
+	t = std::clamp(t, 0.0f, 1.0f);
+	Vector2 closest_point = Vector2Add(wall_start, Vector2Scale(wall_dir, t));
+
+	float distance = Vector2Length(Vector2Subtract(this->position, closest_point));
+	float radius = PLAYER_RADIUS * .85 + (WALL_THICKNESS / 2);
+
+	Vector2 start_to_player = Vector2Subtract(this->position, wall_start);
+	float   start_distance = Vector2Length(start_to_player);
+	if (start_distance < radius + WALL_THICKNESS / 2) {
+		Vector2 start_normal = Vector2Normalize(start_to_player);
+		this->velocity
+		    = Vector2Scale(Vector2Reflect(this->velocity, start_normal), BOUNCE_SLOWDOWN);
+		this->position = Vector2Add(
+		    wall_start, Vector2Scale(start_normal, radius + 0.15f + WALL_THICKNESS / 2));
+	}
+
+	Vector2 end_to_player = Vector2Subtract(this->position, wall_end);
+	float   end_distance = Vector2Length(end_to_player);
+	if (end_distance < radius + WALL_THICKNESS / 2) {
+		Vector2 end_normal = Vector2Normalize(end_to_player);
+		this->velocity = Vector2Scale(Vector2Reflect(this->velocity, end_normal), BOUNCE_SLOWDOWN);
+		this->position
+		    = Vector2Add(wall_end, Vector2Scale(end_normal, radius + 0.15f + WALL_THICKNESS / 2));
+	}
+
+	if (distance < radius) {
+		Vector2 wall_normal = segment.normal;
+
+		if (Vector2DotProduct(Vector2Subtract(this->position, closest_point), wall_normal) < 0) {
+			wall_normal = Vector2Negate(wall_normal);
+		}
+
+		this->hit_wall(level, w, closest_point, wall_normal, wall_dir, radius);
+	}
+}
+
+bool Player::hit_wall(
+    Level &level, u32 w, Vector2 contact, Vector2 wall_normal, Vector2 wall_dir, float radius)
+{
+	auto &wall = level.walls[w];
+	if (wall.kind == Level::Wall::Kind::Door) {
+		auto should_cont = false;
+		for (usize j = 0; j < this->trail.size(); j++) {
+			auto &item = this->trail[j];
+			if (item.ptr->id == wall.key_id) {
+				should_cont = true;
+				level.open_door(w);
+				trail_remove(j);
+			}
+		}
+		if (should_cont || wall.time_since_trigger != -1)
+			return false;
+	}
+
+	float angle_cos = Vector2DotProduct(Vector2Normalize(this->velocity), wall_normal);
+	float angle_degrees = std::acos(angle_cos) * RAD2DEG;
+
+	float initial_speed = Vector2Length(this->velocity);
+
+	if (initial_speed >= PLAYER_SPEED * 0.2)
+		this->audible_wall_hits++;
+
+	constexpr float BOUNCE_ANGLE_THRESHOLD = 20.0f;
+	if (angle_degrees > BOUNCE_ANGLE_THRESHOLD) {
+		constexpr float bounce_factor = BOUNCE_SLOWDOWN;
+		this->velocity = Vector2Scale(Vector2Reflect(this->velocity, wall_normal), bounce_factor);
+	} else {
+		Vector2 wall_tangent = Vector2Normalize(wall_dir);
+		this->velocity = Vector2Scale(wall_tangent, initial_speed);
+	}
+
+	float correction_offset = radius + 0.15f;
+	this->position = Vector2Add(contact, Vector2Scale(wall_normal, correction_offset));
+	return true;
+}
+
 void Player::trail_remove(usize i) { this->trail.erase(this->trail.begin() + i); }
 
 Vector2 Player::get_next_trail_position(void)
@@ -2,7 +2,9 @@
 
 #include <raylib.h>
 
+#include "Input.h"
 #include "Level.h"
+#include "SegmentKernel.h"
 
 constexpr auto PLAYER_TURNING_SPEED = 3;
 constexpr auto PLAYER_RADIUS = 12;
@@ -17,10 +19,12 @@ struct Player {
 		Level::Pickup *ptr;
 		Vector2        position;
 		Vector2        direction;
+		Vector2        previous_position = position;
 	};
 
 	void    render(void); // To be called inside a camera context.
-	void    update(double dt);
+	void    update(Level &level, InputState input, double dt);
+	void    snapshot(void); // Stores the state render() interpolates from.
 	Vector2 get_next_trail_position(void);
 	void    trail_remove(usize i);
 
@@ -29,5 +33,25 @@ struct Player {
 	float   angle  = -90 * DEG2RAD;
 	float   health = PLAYER_MAX_HP;
 
+	Vector2 previous_position;
+	float   previous_angle;
+
 	std::vector<TrailPickup> trail;
+
+	u32 audible_wall_hits = 0; // Counted by update(), left for the caller to clear.
+
+private:
+	// Moves along this update's velocity, stopping and responding at the first wall touched.
+	void sweep(Level &level, double dt);
+	// Opens doors we hold the key for, otherwise bounces or slides off the wall and puts the
+	// player `radius` away from `contact`. Returns false if the wall let us through.
+	bool hit_wall(Level &level, u32 wall, Vector2 contact, Vector2 wall_normal, Vector2 wall_dir,
+	    float radius);
+	// Pushes the player off segment `id` if they overlap, endpoints included.
+	void collide_segment(Level &level, u32 id);
+
+	// Scratch for broadphase queries, reused every update.
+	std::vector<u32>        nearby_segments;
+	std::vector<u32>        nearby_zones;
+	std::vector<SegmentHit> segment_hits;
 };
@@ -0,0 +1,133 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+Profiler g_profiler;
+
+static u64 steady_ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	    std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+Profiler::Profiler(void)
+  : m_epoch(steady_ns())
+{
+}
+
+u64 Profiler::now(void) const { return steady_ns() - m_epoch; }
+
+Profiler::ThreadBuffer &Profiler::local_buffer(void)
+{
+	thread_local ThreadBuffer *buffer = nullptr;
+	if (!buffer) {
+		auto owned = std::make_unique<ThreadBuffer>();
+		owned->events = std::make_unique<Event[]>(PROFILER_EVENTS_PER_THREAD);
+		std::lock_guard lock(m_mutex);
+		owned->thread = m_buffers.size();
+		buffer = m_buffers.emplace_back(std::move(owned)).get();
+	}
+	return *buffer;
+}
+
+void Profiler::name_thread(char const *name) { this->local_buffer().name = name; }
+
+void Profiler::record(char const *name, u64 start, u64 end)
+{
+	auto     &buffer = this->local_buffer();
+	u64 const count = buffer.count.load(std::memory_order_relaxed);
+	buffer.events[count % PROFILER_EVENTS_PER_THREAD] = { name, start, end - start };
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+std::vector<Profiler::Event> Profiler::snapshot(ThreadBuffer const &buffer, u64 since) const
+{
+	u64 const count = buffer.count.load(std::memory_order_acquire);
+	u64 const kept = PROFILER_EVENTS_PER_THREAD - PROFILER_SNAPSHOT_SLACK;
+	u64 const first = count > kept ? count - kept : 0;
+
+	std::vector<Event> events;
+	for (u64 i = first; i < count; i++) {
+		auto const &event = buffer.events[i % PROFILER_EVENTS_PER_THREAD];
+		if (event.start >= since)
+			events.push_back(event);
+	}
+	return events;
+}
+
+std::vector<Profiler::ScopeStats> Profiler::summarize(
+    f64 seconds, char const *frame_scope, u32 &frames) const
+{
+	u64 const now = this->now();
+	u64 const window = seconds * 1e9;
+	u64 const since = now > window ? now - window : 0;
+
+	std::vector<ScopeStats> stats;
+	frames = 0;
+
+	std::lock_guard lock(m_mutex);
+	for (auto const &buffer : m_buffers) {
+		for (auto const &event : this->snapshot(*buffer, since)) {
+			// The same literal can have a different address in each translation unit, so names
+			// are compared by content. There are few enough scopes for a linear search.
+			frames += std::strcmp(event.name, frame_scope) == 0;
+			auto it = std::find_if(stats.begin(), stats.end(), [&](ScopeStats const &s) {
+				return s.name == event.name || std::strcmp(s.name, event.name) == 0;
+			});
+			if (it == stats.end())
+				it = stats.insert(it, { event.name, 0, 0, 0 });
+			f64 const ms = event.duration / 1e6;
+			it->total_ms += ms;
+			it->max_ms = std::max(it->max_ms, ms);
+			it->calls++;
+		}
+	}
+	return stats;
+}
+
+void Profiler::export_chrome_trace(std::filesystem::path path, f64 seconds) const
+{
+	u64 const now = this->now();
+	u64 const window = seconds * 1e9;
+	u64 const since = now > window ? now - window : 0;
+
+	using json = nlohmann::json;
+	json events = json::array();
+	{
+		std::lock_guard lock(m_mutex);
+		for (auto const &buffer : m_buffers) {
+			events.push_back({
+			    { "name", "thread_name" },
+			    { "ph", "M" },
+			    { "pid", 1 },
+			    { "tid", buffer->thread },
+			    { "args",
+			        { { "name",
+			            buffer->name ? buffer->name
+			                         : "thread " + std::to_string(buffer->thread) } } },
+			});
+			for (auto const &event : this->snapshot(*buffer, since)) {
+				events.push_back({
+				    { "name", event.name },
+				    { "ph", "X" },
+				    { "pid", 1 },
+				    { "tid", buffer->thread },
+				    { "ts", event.start / 1e3 },
+				    { "dur", event.duration / 1e3 },
+				});
+			}
+		}
+	}
+
+	std::ofstream f(path);
+	if (!f)
+		throw std::runtime_error("Failed to open file for writing.");
+	f << json { { "traceEvents", events }, { "displayTimeUnit", "ms" } }.dump();
+}
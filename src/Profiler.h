@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common.h"
+
+// Dumps cover this much of the most recent history.
+constexpr usize PROFILER_DUMP_SECONDS = 5;
+// Entries this close behind the write position may be mid-overwrite while a snapshot copies them,
+// so they are left out.
+constexpr usize PROFILER_SNAPSHOT_SLACK = 256;
+// A frame records around a dozen events, sim ticks included. The ring is sized for the whole dump
+// at up to PROFILER_MAX_FPS with room to spare, faster than that only the latest part is kept.
+constexpr usize PROFILER_MAX_FPS = 1000;
+constexpr usize PROFILER_EVENTS_PER_FRAME = 16;
+// Events each thread keeps before overwriting its oldest.
+constexpr usize PROFILER_EVENTS_PER_THREAD =
+    PROFILER_DUMP_SECONDS * PROFILER_MAX_FPS * PROFILER_EVENTS_PER_FRAME + PROFILER_SNAPSHOT_SLACK;
+
+// Named timing scopes, recorded into a ring buffer per thread. Off by default, a disabled scope
+// costs one relaxed load. Scope names must be string literals, they are stored as pointers.
+struct Profiler {
+	struct Event {
+		char const *name;
+		u64         start; // Nanoseconds since the profiler was created.
+		u64         duration;
+	};
+
+	// Totals per scope name over a window, for the overlay.
+	struct ScopeStats {
+		char const *name;
+		f64         total_ms;
+		f64         max_ms; // Longest single call.
+		u32         calls;
+	};
+
+	Profiler(void);
+
+	bool enabled(void) const { return m_enabled.load(std::memory_order_relaxed); }
+	void set_enabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+	u64  now(void) const;
+	void record(char const *name, u64 start, u64 end);
+	// Labels the calling thread's track in exported traces.
+	void name_thread(char const *name);
+
+	// Calls per scope over the last `seconds`, in order of first appearance. `frames` is how many
+	// times `frame_scope` ran in that window, so totals can be shown per frame.
+	std::vector<ScopeStats> summarize(f64 seconds, char const *frame_scope, u32 &frames) const;
+
+	// Writes the last `seconds` of every thread as a Chrome trace_event file, which opens in
+	// chrome://tracing or Perfetto.
+	void export_chrome_trace(std::filesystem::path path, f64 seconds) const;
+
+private:
+	struct ThreadBuffer {
+		u32                      thread;
+		char const              *name = nullptr;
+		std::unique_ptr<Event[]> events;
+		std::atomic<u64>         count = 0; // Ever written, the ring index is modulo.
+	};
+
+	ThreadBuffer &local_buffer(void);
+	// Copies what the owning thread isn't about to overwrite, oldest first.
+	std::vector<Event> snapshot(ThreadBuffer const &buffer, u64 since) const;
+
+	std::atomic<bool>                          m_enabled = false;
+	u64                                        m_epoch;
+	mutable std::mutex                         m_mutex; // Guards m_buffers.
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+extern Profiler g_profiler;
+
+struct ProfileScope {
+	explicit ProfileScope(char const *name)
+	  : m_name(g_profiler.enabled() ? name : nullptr)
+	  , m_start(m_name ? g_profiler.now() : 0)
+	{
+	}
+	~ProfileScope()
+	{
+		if (m_name)
+			g_profiler.record(m_name, m_start, g_profiler.now());
+	}
+
+	ProfileScope(ProfileScope const &) = delete;
+	ProfileScope &operator=(ProfileScope const &) = delete;
+
+private:
+	char const *m_name;
+	u64         m_start;
+};
+
+#define PROFILE_SCOPE_1(x, y) x##y
+#define PROFILE_SCOPE_2(x, y) PROFILE_SCOPE_1(x, y)
+#define PROFILE_SCOPE(name)   ProfileScope PROFILE_SCOPE_2(_profile_scope_, __COUNTER__)(name)
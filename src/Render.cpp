@@ -0,0 +1,171 @@
+#include <cstring>
+#include <string>
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include "Counters.h"
+#include "GameMath.h"
+#include "GameState.h"
+#include "Gui.h"
+#include "Level.h"
+#include "Player.h"
+
+// Drawing for the simulation types, kept apart from their logic so the simulation builds without
+// a window, see Simulation.
+
+void Player::render(void)
+{
+	auto const alpha = g_gs.sim_alpha;
+
+	for (auto const &trailer : this->trail) {
+		auto const &pickup = *trailer.ptr;
+		float       radius = PICKUP_RADIUS;
+		if (pickup.time_since_pickup != -1) {
+			if (pickup.time_since_pickup <= .3) {
+				radius *= pickup.time_since_pickup / .3;
+			}
+		}
+		trailer.ptr->render(Vector2Lerp(trailer.previous_position, trailer.position, alpha),
+		    radius, atan2(trailer.direction.y, trailer.direction.x) * RAD2DEG);
+	}
+
+	g_gs.render_texture(Vector2Lerp(this->previous_position, this->position, alpha), 0,
+	    Lerp(this->previous_angle, this->angle, alpha) * RAD2DEG + 90, PLAYER_RADIUS,
+	    g_gs.palette.primary);
+}
+
+void Level::Pickup::render(Vector2 position, float radius, float theta) const
+{
+	if (!radius)
+		return;
+	Color pickup_color
+	    = this->kind == Level::Pickup::Kind::Key ? g_gs.palette.key_door : g_gs.palette.file;
+	int id;
+	switch (this->kind) {
+	case Kind::Key:
+		id = 1;
+		break;
+	case Kind::File:
+		id = 2;
+		break;
+	}
+	g_gs.render_texture(position, id, theta, radius, pickup_color);
+}
+
+void Level::render(Camera2D *camera, bool origin, bool render_player)
+{
+	if (origin)
+		DrawCircle(0, 0, 2, GREEN);
+
+	if (!this->mesh.is_built())
+		this->mesh.build(*this);
+	g_gs.level_layer.update(*this, *camera, { g_gs.widthf, g_gs.heightf }, g_gs.palette);
+	AABB const view = AABBFromCamera(*camera, { g_gs.widthf, g_gs.heightf });
+
+	BeginMode2D(*camera);
+	{
+		if (!g_gs.level_layer.draw())
+			this->mesh.draw(*this, g_gs.palette, view);
+
+		// The grid hands back whole cells, so check each pickup's own box too.
+		this->visible_pickups.clear();
+		this->mesh.pickup_grid.query(view, this->visible_pickups);
+		usize drawn = 0;
+		for (auto const i : this->visible_pickups) {
+			auto const &pickup = this->pickups[i];
+			if (!CheckCollisionAABBs(
+			        AABBFromSegment(pickup.position, pickup.position, PICKUP_RADIUS), view))
+				continue;
+			drawn++;
+
+			auto radius = PICKUP_RADIUS;
+			if (pickup.time_since_pickup != -1) {
+				if (pickup.time_since_pickup <= .3) {
+					radius *= (.3 - pickup.time_since_pickup) / .3;
+				} else {
+					radius = 0;
+				}
+			}
+
+			pickup.render(pickup.position, radius, 0);
+		}
+		g_counters.add(Counter::PickupsDrawn, drawn);
+		g_counters.add(Counter::PickupsCulled, this->pickups.size() - drawn);
+
+		if (render_player)
+			g_gs.sim.player.render();
+		g_gs.flush_sprites();
+	}
+	EndMode2D();
+}
+
+float ease_out_lerp(float start, float end, float t)
+{
+	t = 1 - (1 - t) * (1 - t);
+	return start + t * (end - start);
+}
+
+float limit(float x, float min, float max)
+{
+	if (x < min)
+		return min;
+	if (x > max)
+		return max;
+	return x;
+}
+
+void Level::render_hud(f64 t)
+{
+	constexpr float WIDTH = 500;
+	constexpr float HEIGHT = 320;
+
+	auto const &entry = g_gs.levels.entry(*g_gs.current_level);
+
+	float x = g_gs.widthf / 2 - WIDTH / 2;
+	float y = ease_out_lerp(g_gs.heightf, g_gs.heightf / 2 - HEIGHT / 2, limit(t, 0, 1));
+
+	DrawRectangle(x - BORDER_WIDTH, y - BORDER_WIDTH, WIDTH + BORDER_WIDTH * 2,
+	    HEIGHT + BORDER_WIDTH * 2, g_gs.palette.primary);
+	DrawRectangle(x, y, WIDTH, HEIGHT, g_gs.palette.menu_background);
+	constexpr auto text = "DATA SENT";
+	constexpr auto text_size = 40;
+
+	float start_x = x + WIDTH / 2
+	    - MeasureTextEx(g_gs.font, " ", text_size * 2, 0).x * 1.5 * (strlen(text) - 1) * .5 - 15;
+	for (size_t i = 0; i < strlen(text); ++i) {
+		float char_x = start_x + i * MeasureTextEx(g_gs.font, " ", text_size * 2, 0).x * 1.5;
+		float bounce_offset = sin(t * 3.0f + i * 0.3f) * 10.0f - 15;
+		DrawTextEx(g_gs.font, TextSubtext(text, i, 1), { char_x, y + text_size + bounce_offset },
+		    text_size * 2, 0, g_gs.palette.primary);
+	}
+
+	constexpr auto PADDING = 20;
+	constexpr auto FONT_SIZE = 30;
+	constexpr auto FONT_SPACING = 2;
+	float          off = y + text_size * 2 + PADDING * 2;
+	if (t > .75) {
+		auto time = std::string(format_time(g_gs.sim.completion_time));
+		DrawTextEx(g_gs.font, TextFormat("Completion time: %s", time.c_str()), { x + PADDING, off },
+		    FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
+		off += FONT_SIZE * .75 + PADDING / 2;
+	}
+	if (t > 1) {
+		DrawTextEx(g_gs.font,
+		    TextFormat("Files collected: %d/%d", entry.collected_files, entry.total_files),
+		    { x + PADDING, off }, FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
+		off += FONT_SIZE * .75 + PADDING / 2;
+	}
+	if (t > 1.25) {
+		auto time = std::string(format_time(this->author_time));
+		DrawTextEx(g_gs.font, TextFormat("Author completion time: %s", time.c_str()),
+		    { x + PADDING, off }, FONT_SIZE, FONT_SPACING, g_gs.palette.primary);
+		off += FONT_SIZE * .75 + PADDING / 2;
+	}
+	off += FONT_SIZE * .75 + PADDING / 2;
+	if (t > 1.5) {
+		if (GuiButton(
+		        { x + PADDING, static_cast<float>(off), WIDTH - PADDING * 2, 50 }, "Back to map"))
+			g_gs.current_level = {};
+	}
+}
@@ -0,0 +1,110 @@
+#include "Replay.h"
+
+#include <fstream>
+#include <stdexcept>
+
+// Far longer than any run, keeps a corrupt tick count from allocating without bound.
+constexpr u64 MAX_REPLAY_TICKS = u64(1) << 28;
+// Likewise far above any real rate, the fixed step loop runs this many ticks per second.
+constexpr u64 MAX_REPLAY_SIM_RATE = 1000;
+
+static void put_varint(std::vector<u8> &out, u64 value)
+{
+	do {
+		u8 byte = value & 0x7f;
+		value >>= 7;
+		out.push_back(byte | (value ? 0x80 : 0));
+	} while (value);
+}
+
+static u64 get_varint(std::span<u8 const> bytes, usize &at)
+{
+	u64 value = 0;
+	for (u32 shift = 0; shift < 64; shift += 7) {
+		if (at >= bytes.size())
+			throw std::runtime_error("Replay is truncated.");
+		u8 const byte = bytes[at++];
+		value |= static_cast<u64>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return value;
+	}
+	throw std::runtime_error("Replay has a malformed varint.");
+}
+
+std::vector<u8> Replay::encode(void) const
+{
+	std::vector<u8> out;
+	put_varint(out, MAGIC);
+	put_varint(out, VERSION);
+	put_varint(out, this->sim_rate);
+	put_varint(out, this->level);
+	put_varint(out, this->level_name.size());
+	out.insert(out.end(), this->level_name.begin(), this->level_name.end());
+	put_varint(out, this->ticks.size());
+
+	for (usize i = 0; i < this->ticks.size();) {
+		usize run = 1;
+		while (i + run < this->ticks.size() && this->ticks[i + run] == this->ticks[i])
+			run++;
+		out.push_back(this->ticks[i].bits);
+		put_varint(out, run);
+		i += run;
+	}
+	return out;
+}
+
+Replay Replay::decode(std::span<u8 const> bytes)
+{
+	usize at = 0;
+	if (get_varint(bytes, at) != MAGIC)
+		throw std::runtime_error("Not a replay file.");
+	if (get_varint(bytes, at) != VERSION)
+		throw std::runtime_error("Unsupported replay version.");
+
+	Replay replay;
+	u64 const sim_rate = get_varint(bytes, at);
+	if (!sim_rate)
+		throw std::runtime_error("Replay has no sim rate.");
+	if (sim_rate > MAX_REPLAY_SIM_RATE)
+		throw std::runtime_error("Replay sim rate is too high.");
+	replay.sim_rate = sim_rate;
+	replay.level = get_varint(bytes, at);
+	u64 const name_size = get_varint(bytes, at);
+	if (name_size > bytes.size() - at)
+		throw std::runtime_error("Replay is truncated.");
+	replay.level_name.assign(reinterpret_cast<char const *>(bytes.data() + at), name_size);
+	at += name_size;
+
+	u64 const tick_count = get_varint(bytes, at);
+	if (tick_count > MAX_REPLAY_TICKS)
+		throw std::runtime_error("Replay is too long.");
+	while (replay.ticks.size() < tick_count) {
+		if (at >= bytes.size())
+			throw std::runtime_error("Replay is truncated.");
+		InputState const input { bytes[at++] };
+		u64 const        run = get_varint(bytes, at);
+		if (!run || run > tick_count - replay.ticks.size())
+			throw std::runtime_error("Replay has a malformed run.");
+		replay.ticks.insert(replay.ticks.end(), run, input);
+	}
+	return replay;
+}
+
+void Replay::export_to_file(std::filesystem::path path) const
+{
+	auto const    bytes = this->encode();
+	std::ofstream f(path, std::ios::binary);
+	if (!f)
+		throw std::runtime_error("Failed to open file for writing.");
+	f.write(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+}
+
+Replay Replay::read_from_file(std::filesystem::path path)
+{
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		throw std::runtime_error("Failed to open file for reading.");
+	std::vector<u8> const bytes(
+	    (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	return decode(bytes);
+}
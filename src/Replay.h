@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Input.h"
+#include "common.h"
+
+// The input of one run, enough to re-simulate it exactly given the same level and sim rate.
+//
+// On disk: magic, version, sim rate, level index, level name and tick count, then the ticks as
+// runs of identical input, each a control byte followed by its length as a LEB128 varint. Input
+// rarely changes more than a few times a second, so a minute of play is a few hundred bytes.
+struct Replay {
+	static constexpr u32 MAGIC = 'B' | 'R' << 8 | 'R' << 16 | 'P' << 24;
+	static constexpr u32 VERSION = 1;
+
+	u32                     sim_rate = 0;
+	u32                     level = 0;
+	std::string             level_name;
+	std::vector<InputState> ticks;
+
+	std::vector<u8> encode(void) const;
+	static Replay   decode(std::span<u8 const> bytes);
+
+	void          export_to_file(std::filesystem::path path) const;
+	static Replay read_from_file(std::filesystem::path path);
+};
@@ -0,0 +1,192 @@
+#include "SegmentKernel.h"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define BYTERACER_SSE2
+// Picking AVX2 at runtime needs the target attribute and __builtin_cpu_supports().
+#if defined(__GNUC__) || defined(__clang__)
+#define BYTERACER_AVX2
+#endif
+// vaddvq_u32() is AArch64 only.
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define BYTERACER_NEON
+#endif
+
+using Kernel = void (*)(Vector2 center, f32 radius_sq, Level::Segments const &segments,
+    std::span<u32 const> ids, usize first, std::vector<SegmentHit> &hits);
+
+static void hits_scalar(Vector2 center, f32 radius_sq, Level::Segments const &segments,
+    std::span<u32 const> ids, usize first, std::vector<SegmentHit> &hits)
+{
+	for (usize i = first; i < ids.size(); i++) {
+		u32 const id = ids[i];
+		f32 const px = center.x - segments.start_x[id], py = center.y - segments.start_y[id];
+		f32 const dx = segments.dir_x[id], dy = segments.dir_y[id];
+		f32 const t = std::clamp((px * dx + py * dy) * segments.inv_length_sq[id], 0.f, 1.f);
+		f32 const qx = px - t * dx, qy = py - t * dy;
+		f32 const distance_sq = qx * qx + qy * qy;
+		if (distance_sq < radius_sq)
+			hits.push_back({ static_cast<u32>(i), t, distance_sq });
+	}
+}
+
+// Appends the lanes set in `mask` for the block of ids starting at `base`.
+static void emit(usize base, u32 mask, f32 const *t, f32 const *distance_sq,
+    std::vector<SegmentHit> &hits)
+{
+	while (mask) {
+		u32 const lane = std::countr_zero(mask);
+		hits.push_back({ static_cast<u32>(base + lane), t[lane], distance_sq[lane] });
+		mask &= mask - 1;
+	}
+}
+
+#if defined(BYTERACER_SSE2)
+static void hits_sse2(Vector2 center, f32 radius_sq, Level::Segments const &segments,
+    std::span<u32 const> ids, usize first, std::vector<SegmentHit> &hits)
+{
+	__m128 const cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y);
+	__m128 const r2 = _mm_set1_ps(radius_sq);
+	__m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+
+	usize i = first;
+	for (; i + 4 <= ids.size(); i += 4) {
+		u32 const *id = ids.data() + i;
+		// No gather before AVX2, the ids come from a grid query and are scattered anyway.
+		auto const load = [id](std::vector<f32> const &v) {
+			return _mm_setr_ps(v[id[0]], v[id[1]], v[id[2]], v[id[3]]);
+		};
+		__m128 const px = _mm_sub_ps(cx, load(segments.start_x));
+		__m128 const py = _mm_sub_ps(cy, load(segments.start_y));
+		__m128 const dx = load(segments.dir_x), dy = load(segments.dir_y);
+
+		__m128 t = _mm_add_ps(_mm_mul_ps(px, dx), _mm_mul_ps(py, dy));
+		t = _mm_mul_ps(t, load(segments.inv_length_sq));
+		t = _mm_min_ps(_mm_max_ps(t, zero), one);
+		__m128 const qx = _mm_sub_ps(px, _mm_mul_ps(t, dx));
+		__m128 const qy = _mm_sub_ps(py, _mm_mul_ps(t, dy));
+		__m128 const d2 = _mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy));
+
+		u32 const mask = _mm_movemask_ps(_mm_cmplt_ps(d2, r2));
+		if (mask) {
+			alignas(16) f32 ts[4], ds[4];
+			_mm_store_ps(ts, t);
+			_mm_store_ps(ds, d2);
+			emit(i, mask, ts, ds, hits);
+		}
+	}
+	hits_scalar(center, radius_sq, segments, ids, i, hits);
+}
+#endif
+
+#if defined(BYTERACER_AVX2)
+__attribute__((target("avx2"))) static void hits_avx2(Vector2 center, f32 radius_sq,
+    Level::Segments const &segments, std::span<u32 const> ids, usize first,
+    std::vector<SegmentHit> &hits)
+{
+	__m256 const cx = _mm256_set1_ps(center.x), cy = _mm256_set1_ps(center.y);
+	__m256 const r2 = _mm256_set1_ps(radius_sq);
+	__m256 const zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1);
+
+	usize i = first;
+	for (; i + 8 <= ids.size(); i += 8) {
+		// Segment ids fit in an i32, a level would need billions of points otherwise.
+		__m256i const id = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ids.data() + i));
+		__m256 const  px = _mm256_sub_ps(cx, _mm256_i32gather_ps(segments.start_x.data(), id, 4));
+		__m256 const  py = _mm256_sub_ps(cy, _mm256_i32gather_ps(segments.start_y.data(), id, 4));
+		__m256 const  dx = _mm256_i32gather_ps(segments.dir_x.data(), id, 4);
+		__m256 const  dy = _mm256_i32gather_ps(segments.dir_y.data(), id, 4);
+
+		__m256 t = _mm256_add_ps(_mm256_mul_ps(px, dx), _mm256_mul_ps(py, dy));
+		t = _mm256_mul_ps(t, _mm256_i32gather_ps(segments.inv_length_sq.data(), id, 4));
+		t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+		__m256 const qx = _mm256_sub_ps(px, _mm256_mul_ps(t, dx));
+		__m256 const qy = _mm256_sub_ps(py, _mm256_mul_ps(t, dy));
+		__m256 const d2 = _mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy));
+
+		u32 const mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LT_OQ));
+		if (mask) {
+			alignas(32) f32 ts[8], ds[8];
+			_mm256_store_ps(ts, t);
+			_mm256_store_ps(ds, d2);
+			emit(i, mask, ts, ds, hits);
+		}
+	}
+	hits_sse2(center, radius_sq, segments, ids, i, hits);
+}
+#endif
+
+#if defined(BYTERACER_NEON)
+static void hits_neon(Vector2 center, f32 radius_sq, Level::Segments const &segments,
+    std::span<u32 const> ids, usize first, std::vector<SegmentHit> &hits)
+{
+	float32x4_t const cx = vdupq_n_f32(center.x), cy = vdupq_n_f32(center.y);
+	float32x4_t const r2 = vdupq_n_f32(radius_sq);
+	float32x4_t const zero = vdupq_n_f32(0), one = vdupq_n_f32(1);
+	uint32x4_t const  lanes = { 1, 2, 4, 8 };
+
+	usize i = first;
+	for (; i + 4 <= ids.size(); i += 4) {
+		u32 const *id = ids.data() + i;
+		auto const load = [id](std::vector<f32> const &v) {
+			alignas(16) f32 const gathered[4] = { v[id[0]], v[id[1]], v[id[2]], v[id[3]] };
+			return vld1q_f32(gathered);
+		};
+		float32x4_t const px = vsubq_f32(cx, load(segments.start_x));
+		float32x4_t const py = vsubq_f32(cy, load(segments.start_y));
+		float32x4_t const dx = load(segments.dir_x), dy = load(segments.dir_y);
+
+		float32x4_t t = vaddq_f32(vmulq_f32(px, dx), vmulq_f32(py, dy));
+		t = vmulq_f32(t, load(segments.inv_length_sq));
+		t = vminq_f32(vmaxq_f32(t, zero), one);
+		float32x4_t const qx = vsubq_f32(px, vmulq_f32(t, dx));
+		float32x4_t const qy = vsubq_f32(py, vmulq_f32(t, dy));
+		float32x4_t const d2 = vaddq_f32(vmulq_f32(qx, qx), vmulq_f32(qy, qy));
+
+		uint32x4_t const hit = vcltq_f32(d2, r2);
+		u32 const        mask = vaddvq_u32(vandq_u32(hit, lanes));
+		if (mask) {
+			alignas(16) f32 ts[4], ds[4];
+			vst1q_f32(ts, t);
+			vst1q_f32(ds, d2);
+			emit(i, mask, ts, ds, hits);
+		}
+	}
+	hits_scalar(center, radius_sq, segments, ids, i, hits);
+}
+#endif
+
+struct KernelChoice {
+	Kernel      kernel;
+	char const *name;
+};
+
+static KernelChoice const &kernel_choice(void)
+{
+	static KernelChoice const choice = []() -> KernelChoice {
+#if defined(BYTERACER_AVX2)
+		if (__builtin_cpu_supports("avx2"))
+			return { hits_avx2, "avx2" };
+#endif
+#if defined(BYTERACER_SSE2)
+		return { hits_sse2, "sse2" };
+#elif defined(BYTERACER_NEON)
+		return { hits_neon, "neon" };
+#else
+		return { hits_scalar, "scalar" };
+#endif
+	}();
+	return choice;
+}
+
+void CollideCircleSegments(Vector2 center, f32 radius, Level::Segments const &segments,
+    std::span<u32 const> ids, std::vector<SegmentHit> &hits)
+{
+	kernel_choice().kernel(center, radius * radius, segments, ids, 0, hits);
+}
+
+char const *CollideCircleSegmentsKernel(void) { return kernel_choice().name; }
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <raylib.h>
+
+#include "Level.h"
+#include "common.h"
+
+struct SegmentHit {
+	u32 item; // Index into the `ids` given to CollideCircleSegments().
+	f32 t; // Of the closest point along the segment, in [0, 1].
+	f32 distance_sq; // From the circle's center to that point.
+};
+
+// Appends every segment among `ids` whose closest point is nearer than `radius` to `center`, in
+// the order of `ids`. Tests 8 segments at a time with AVX2 or 4 with SSE2 or NEON, whichever is
+// the widest the CPU has, and falls back to plain code otherwise.
+//
+// The lanes can round differently from the scalar collision code, e.g. where the compiler fuses
+// a multiply and add there, so callers give `radius` some slack and redo the exact test for each
+// hit. The kernel only has to be conservative, that way replays stay bit-exact.
+void CollideCircleSegments(Vector2 center, f32 radius, Level::Segments const &segments,
+    std::span<u32 const> ids, std::vector<SegmentHit> &hits);
+
+// "avx2", "sse2", "neon" or "scalar", the implementation CollideCircleSegments() picked.
+char const *CollideCircleSegmentsKernel(void);
@@ -0,0 +1,23 @@
+#include "Shaders.h"
+
+#include <string>
+
+#include <rlgl.h>
+
+Shader LoadShaderGlsl3(char const *vs, char const *fs)
+{
+	int const version = rlGetVersion();
+	if (version != RL_OPENGL_33 && version != RL_OPENGL_43 && version != RL_OPENGL_ES_30)
+		return {};
+
+	std::string const header = version == RL_OPENGL_ES_30
+	    ? "#version 300 es\nprecision highp float;\n"
+	    : "#version 330\n";
+	Shader const shader = LoadShaderFromMemory((header + vs).c_str(), (header + fs).c_str());
+	// raylib hands back its default shader when compiling or linking fails.
+	if (shader.id == rlGetShaderIdDefault()) {
+		TraceLog(LOG_WARNING, "SHADER: Falling back, GLSL 3 shader failed to build");
+		return {};
+	}
+	return shader;
+}
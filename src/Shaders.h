@@ -0,0 +1,8 @@
+#pragma once
+
+#include <raylib.h>
+
+// Compiles a GLSL 3 shader, prefixing `vs` and `fs` with the #version line the context needs.
+// Only OpenGL 3.3 and ES 3 contexts take them, web builds run on WebGL 1. Returns a shader with
+// id 0 if the context is older or the shader fails to build, callers keep a fallback for that.
+Shader LoadShaderGlsl3(char const *vs, char const *fs);
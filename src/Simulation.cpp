@@ -0,0 +1,123 @@
+#include "Simulation.h"
+
+#include <raymath.h>
+
+#include "GameMath.h"
+#include "Profiler.h"
+
+void Simulation::start(Level &level, bool reset_dialog)
+{
+	this->level = &level;
+	level.reset_doors();
+	for (auto &zone : level.zones) {
+		if (reset_dialog)
+			zone.time_since_trigger = -1;
+	}
+	for (auto &pickup : level.pickups) {
+		pickup.time_since_pickup = -1;
+	}
+
+	this->player.position = level.start_position;
+	this->player.velocity = { 0, 0 };
+	this->player.angle = level.start_angle;
+	this->player.trail.clear();
+	this->player.health = PLAYER_MAX_HP;
+	this->player.snapshot();
+
+	this->time_spent = 0;
+	this->completion_time = 0;
+}
+
+void Simulation::tick(f64 dt, InputState input)
+{
+	auto &level = *this->level;
+	this->events = 0;
+
+	if (input.held(InputState::Restart)) {
+		this->start(level, false);
+		this->events |= Restart;
+		return;
+	}
+
+	this->time_spent += dt;
+
+	{
+		PROFILE_SCOPE("player_update");
+		this->player.audible_wall_hits = 0;
+		this->player.update(level, this->completion_time ? InputState {} : input, dt);
+		if (this->player.audible_wall_hits)
+			this->events |= WallHit;
+	}
+
+	{
+		PROFILE_SCOPE("pickups");
+		for (auto &pickup : level.pickups) {
+			if (pickup.time_since_pickup != -1) {
+				pickup.time_since_pickup += dt;
+			} else {
+				constexpr float reach = PLAYER_RADIUS + PICKUP_RADIUS;
+				if (Vector2DistanceSqr(this->player.position, pickup.position) <= reach * reach) {
+					pickup.time_since_pickup = 0;
+					Vector2 const position = this->player.get_next_trail_position();
+					this->player.trail.push_back(Player::TrailPickup { &pickup, position, {} });
+					this->events |= Pickup;
+				}
+			}
+		}
+	}
+
+	bool in_danger = false;
+	{
+		PROFILE_SCOPE("zones");
+		m_nearby_zones.clear();
+		level.zone_bvh.query(
+		    AABBFromSegment(this->player.position, this->player.position, PLAYER_RADIUS),
+		    m_nearby_zones);
+		for (auto const z : m_nearby_zones) {
+			auto &zone = level.zones[z];
+			if (!CheckCollisionCirclePoly(this->player.position, PLAYER_RADIUS, level.points_of(zone)))
+				continue;
+
+			if (!in_danger && zone.kind == Level::Zone::Kind::Danger) {
+				in_danger = true;
+			} else if (zone.kind == Level::Zone::Kind::End) {
+				if (!this->completion_time) {
+					this->completion_time = this->time_spent;
+					this->collected_files = 0;
+					this->total_files = 0;
+					for (auto &pickup : level.pickups) {
+						if (pickup.kind != Level::Pickup::Kind::File)
+							continue;
+						this->total_files++;
+						this->collected_files += pickup.time_since_pickup != -1;
+					}
+					this->events |= Completed;
+				}
+			} else if (zone.kind == Level::Zone::Kind::DialogTrigger) {
+				if (zone.time_since_trigger == -1) {
+					zone.time_since_trigger = 0;
+					this->dialog_index = zone.value.dialog_index;
+					this->events |= Dialog;
+				}
+			}
+		}
+
+		for (auto const z : level.dialog_zones) {
+			auto &zone = level.zones[z];
+			if (zone.time_since_trigger != -1)
+				zone.time_since_trigger += dt;
+		}
+	}
+
+	if (in_danger)
+		this->player.health -= dt;
+	else
+		this->player.health += dt;
+
+	if (this->player.health > PLAYER_MAX_HP) {
+		this->player.health = PLAYER_MAX_HP;
+	} else if (this->player.health < 0) {
+		this->start(level, false);
+		this->events |= Death | Restart;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "Input.h"
+#include "Level.h"
+#include "Player.h"
+#include "common.h"
+
+// One run through a level: the player, the level's mutable state and the clock. It only moves
+// forward through tick(), so the same input at the same rate always plays out the same way. No
+// window, audio or global state is touched in here, what happened during a tick is reported in
+// `events` for the game to turn into sounds and dialogs.
+struct Simulation {
+	enum Event : u32 {
+		WallHit = 1 << 0,
+		Pickup = 1 << 1,
+		Death = 1 << 2,
+		Restart = 1 << 3, // The run started over, after a death or on request.
+		Dialog = 1 << 4, // A dialog zone was entered, see `dialog_index`.
+		Completed = 1 << 5,
+	};
+
+	// Resets `level` and the player to the start. Dialog zones that already fired stay quiet
+	// unless `reset_dialog` is set.
+	void start(Level &level, bool reset_dialog);
+	void tick(f64 dt, InputState input);
+
+	Level *level = nullptr;
+	Player player;
+	f64    time_spent = 0;
+	f64    completion_time = 0; // Zero until the end zone is reached.
+
+	// Counted when the level is completed.
+	int collected_files = 0, total_files = 0;
+
+	u32 events = 0; // Of the last tick.
+	i32 dialog_index = -1;
+
+private:
+	std::vector<u32> m_nearby_zones;
+};
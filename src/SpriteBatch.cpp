@@ -0,0 +1,193 @@
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <raymath.h>
+#include <rlgl.h>
+
+#include "Counters.h"
+#include "Shaders.h"
+
+// Quads are drawn as two triangles over [-1, 1], scaled by the instance's size.
+static f32 const QUAD[] = { -1, -1, 1, -1, 1, 1, -1, -1, 1, 1, -1, 1 };
+
+static char const *SPRITE_VS = R"(
+in vec2 vertexPosition;
+in vec4 instanceTransform; // x, y, angle in degrees, size
+in float instanceSprite;
+in vec4 instanceTint;
+
+uniform mat4 mvp;
+uniform vec4 sources[16]; // SpriteBatch::MAX_SPRITES of them, u0, v0, u1, v1.
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+
+void main()
+{
+	float angle = radians(instanceTransform.z);
+	vec2  corner = vertexPosition * instanceTransform.w;
+	vec2  position = instanceTransform.xy
+	    + vec2(corner.x * cos(angle) - corner.y * sin(angle),
+	        corner.x * sin(angle) + corner.y * cos(angle));
+	vec4 source = sources[int(instanceSprite)];
+	fragTexCoord = mix(source.xy, source.zw, vertexPosition * 0.5 + 0.5);
+	fragColor = instanceTint;
+	gl_Position = mvp * vec4(position, 0.0, 1.0);
+}
+)";
+
+static char const *SPRITE_FS = R"(
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+
+out vec4 finalColor;
+
+void main() { finalColor = texture(texture0, fragTexCoord) * fragColor; }
+)";
+
+static char const *const ATTRIBUTES[] = { "vertexPosition", "instanceTransform",
+	"instanceSprite", "instanceTint" };
+
+void SpriteBatch::load(void)
+{
+	m_shader = LoadShaderGlsl3(SPRITE_VS, SPRITE_FS);
+	if (!m_shader.id)
+		return;
+
+	m_mvp_loc = GetShaderLocation(m_shader, "mvp");
+	m_sources_loc = GetShaderLocation(m_shader, "sources");
+	bool ok = m_mvp_loc != -1 && m_sources_loc != -1;
+	for (auto const *name : ATTRIBUTES)
+		ok = ok && GetShaderLocationAttrib(m_shader, name) != -1;
+	if (!ok || !(m_vao = rlLoadVertexArray())) {
+		TraceLog(LOG_WARNING, "SPRITES: Instancing unavailable, drawing sprites one by one");
+		UnloadShader(m_shader);
+		m_shader = {};
+		return;
+	}
+
+	rlEnableVertexArray(m_vao);
+	m_quad_vbo = rlLoadVertexBuffer(QUAD, sizeof(QUAD), false);
+	u32 const position = GetShaderLocationAttrib(m_shader, ATTRIBUTES[0]);
+	rlSetVertexAttribute(position, 2, RL_FLOAT, false, 0, nullptr);
+	rlEnableVertexAttribute(position);
+	rlDisableVertexArray();
+}
+
+void SpriteBatch::unload(void)
+{
+	// The instance buffer only exists after the first instanced flush.
+	if (m_instance_vbo)
+		rlUnloadVertexBuffer(m_instance_vbo);
+	if (m_quad_vbo)
+		rlUnloadVertexBuffer(m_quad_vbo);
+	if (m_vao)
+		rlUnloadVertexArray(m_vao);
+	if (m_shader.id)
+		UnloadShader(m_shader);
+	m_shader = {};
+	m_vao = m_quad_vbo = m_instance_vbo = 0;
+	m_capacity = 0;
+	m_sheet_id = 0;
+	m_instances.clear();
+}
+
+void SpriteBatch::add(Vector2 position, u32 id, f32 angle, f32 size, Color tint)
+{
+	g_counters.add(Counter::TextureDraws);
+	m_instances.push_back({ position.x, position.y, angle, size,
+	    static_cast<f32>(std::min(id, MAX_SPRITES - 1)), tint });
+}
+
+void SpriteBatch::flush(Texture2D const &sheet)
+{
+	if (m_instances.empty())
+		return;
+	if (!sheet.id) {
+		m_instances.clear(); // Still loading, DrawTexturePro() would skip them as well.
+		return;
+	}
+
+	if (sheet.id != m_sheet_id) {
+		f32 const size = sheet.height;
+		Vector4   uvs[MAX_SPRITES];
+		for (u32 i = 0; i < MAX_SPRITES; i++) {
+			m_sources[i] = { i * size, 0, size, size };
+			uvs[i] = { i * size / sheet.width, 0, (i + 1) * size / sheet.width, 1 };
+		}
+		if (this->instanced())
+			SetShaderValueV(m_shader, m_sources_loc, uvs, SHADER_UNIFORM_VEC4, MAX_SPRITES);
+		m_sheet_id = sheet.id;
+	}
+
+	g_counters.add(Counter::SpriteBatches);
+	if (!this->instanced()) {
+		for (auto const &sprite : m_instances) {
+			Rectangle const dest = { sprite.x, sprite.y, sprite.size * 2, sprite.size * 2 };
+			DrawTexturePro(sheet, m_sources[static_cast<u32>(sprite.sprite)], dest,
+			    { sprite.size, sprite.size }, sprite.angle, sprite.tint);
+		}
+		m_instances.clear();
+		return;
+	}
+
+	// Instanced draws bypass the immediate-mode batch, flush it so earlier draws stay underneath.
+	rlDrawRenderBatchActive();
+	this->reserve(m_instances.size());
+	rlUpdateVertexBuffer(
+	    m_instance_vbo, m_instances.data(), m_instances.size() * sizeof(Instance), 0);
+
+	Matrix const mvp = MatrixMultiply(
+	    MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview()), rlGetMatrixProjection());
+	rlEnableShader(m_shader.id);
+	rlSetUniformMatrix(m_mvp_loc, mvp);
+	rlActiveTextureSlot(0);
+	rlEnableTexture(sheet.id);
+	// The 2D projection flips Y, which would make the front faces cull away.
+	rlDisableBackfaceCulling();
+
+	rlEnableVertexArray(m_vao);
+	rlDrawVertexArrayInstanced(0, 6, m_instances.size());
+	rlDisableVertexArray();
+
+	rlEnableBackfaceCulling();
+	rlDisableTexture();
+	rlDisableShader();
+	m_instances.clear();
+}
+
+void SpriteBatch::reserve(usize count)
+{
+	if (count <= m_capacity)
+		return;
+
+	m_capacity = std::max({ count, m_capacity * 2, usize(256) });
+	if (m_instance_vbo)
+		rlUnloadVertexBuffer(m_instance_vbo);
+
+	// The attributes point into the buffer, so they are set up again along with it.
+	rlEnableVertexArray(m_vao);
+	m_instance_vbo = rlLoadVertexBuffer(nullptr, m_capacity * sizeof(Instance), true);
+	struct Attribute {
+		int   components, type;
+		bool  normalized;
+		usize offset;
+	};
+	Attribute const layout[] = {
+		{ 4, RL_FLOAT, false, offsetof(Instance, x) },
+		{ 1, RL_FLOAT, false, offsetof(Instance, sprite) },
+		{ 4, RL_UNSIGNED_BYTE, true, offsetof(Instance, tint) },
+	};
+	for (usize i = 0; i < std::size(layout); i++) {
+		u32 const location = GetShaderLocationAttrib(m_shader, ATTRIBUTES[i + 1]);
+		rlSetVertexAttribute(location, layout[i].components, layout[i].type, layout[i].normalized,
+		    sizeof(Instance), reinterpret_cast<void const *>(layout[i].offset));
+		rlEnableVertexAttribute(location);
+		rlSetVertexAttributeDivisor(location, 1);
+	}
+	rlDisableVertexArray();
+}
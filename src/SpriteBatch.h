@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib.h>
+
+#include "common.h"
+
+// Sprites from the spritesheet, queued during a frame and drawn together. With OpenGL 3.3 or ES 3
+// a flush is a single instanced draw call, the quads being placed and rotated by a small vertex
+// shader. Elsewhere, or if the shader fails to build, it falls back to DrawTexturePro(), which
+// raylib still merges into one batch as long as nothing else is drawn in between.
+struct SpriteBatch {
+	// The sheet is a row of square sprites, `id` counting from the left.
+	static constexpr u32 MAX_SPRITES = 16;
+
+	// Needs a GL context, the sheet can still be loading.
+	void load(void);
+	void unload(void);
+
+	// Same arguments as DrawTexturePro() with a square destination centered on `position`, and
+	// `angle` in degrees.
+	void add(Vector2 position, u32 id, f32 angle, f32 size, Color tint);
+	// Draws everything added since the last flush with the current transform, under whatever
+	// was drawn before. Call it before drawing anything that should go on top.
+	void flush(Texture2D const &sheet);
+
+private:
+	struct Instance {
+		f32   x, y, angle, size; // Read as one vec4 by the shader.
+		f32   sprite;
+		Color tint;
+	};
+
+	bool instanced(void) const { return m_vao != 0; }
+	void reserve(usize count);
+
+	std::vector<Instance> m_instances;
+
+	Shader m_shader {};
+	int    m_mvp_loc = -1;
+	int    m_sources_loc = -1;
+	u32    m_vao = 0; // 0 when drawing through the fallback.
+	u32    m_quad_vbo = 0;
+	u32    m_instance_vbo = 0;
+	usize  m_capacity = 0; // Instances m_instance_vbo holds.
+
+	// Per sprite id, in texels for the fallback. Rebuilt when the sheet changes.
+	Rectangle m_sources[MAX_SPRITES] {};
+	u32       m_sheet_id = 0;
+	u32       m_sprite_count = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "common.h"
+
+// Bounded lock-free single-producer/single-consumer ring. Slots are filled and drained in place,
+// so large elements are never copied. `N` has to be a power of two.
+template <typename T, usize N>
+struct SpscQueue {
+	static_assert(N && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+	// Producer side: returns a free slot or nullptr if the consumer has fallen behind.
+	T *acquire(void)
+	{
+		auto const head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == N)
+			return nullptr;
+		return &m_slots[head % N];
+	}
+	void publish(void) { m_head.fetch_add(1, std::memory_order_release); }
+
+	// Consumer side: returns the oldest published slot or nullptr if there is none.
+	T const *peek(void)
+	{
+		auto const tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+			return nullptr;
+		return &m_slots[tail % N];
+	}
+	void release(void) { m_tail.fetch_add(1, std::memory_order_release); }
+
+private:
+	std::array<T, N> m_slots {};
+
+	// On separate cache lines so the two threads don't keep stealing them from each other.
+	alignas(64) std::atomic<usize> m_head = 0;
+	alignas(64) std::atomic<usize> m_tail = 0;
+};
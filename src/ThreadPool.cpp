@@ -0,0 +1,47 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(usize workers)
+{
+	m_workers.reserve(workers);
+	for (usize i = 0; i < workers; i++)
+		m_workers.emplace_back([this] { this->work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto &worker : m_workers)
+		worker.join();
+}
+
+usize ThreadPool::default_worker_count(void)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	return 0;
+#else
+	return std::max(1u, std::thread::hardware_concurrency()) - 1;
+#endif
+}
+
+void ThreadPool::work(void)
+{
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+			// Queued jobs still run on shutdown so no future is left without a value.
+			if (m_jobs.empty())
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		job();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+
+// Fixed set of worker threads draining a shared job queue. With zero workers, as on the web
+// build where there are no threads, submit() runs the job on the calling thread instead.
+struct ThreadPool {
+	// Defaults to one worker per hardware thread, minus the caller's.
+	explicit ThreadPool(usize workers = default_worker_count());
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+
+	template <typename F>
+	auto submit(F &&job) -> std::future<std::invoke_result_t<F>>
+	{
+		using R = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(job));
+		auto future = task->get_future();
+		if (m_workers.empty()) {
+			(*task)();
+			return future;
+		}
+		{
+			std::lock_guard lock(m_mutex);
+			m_jobs.emplace([task] { (*task)(); });
+		}
+		m_wake.notify_one();
+		return future;
+	}
+
+	usize worker_count(void) const { return m_workers.size(); }
+
+	static usize default_worker_count(void);
+
+private:
+	void work(void);
+
+	std::vector<std::thread>          m_workers;
+	std::queue<std::function<void()>> m_jobs;
+	std::mutex                        m_mutex;
+	std::condition_variable           m_wake;
+	bool                              m_stopping = false;
+};
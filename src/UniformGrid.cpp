@@ -0,0 +1,102 @@
+#include "UniformGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Upper bound on cells per item, keeps sparse levels with far-apart walls from exploding.
+constexpr auto MAX_CELLS_PER_ITEM = 4;
+constexpr auto MIN_CELLS = 1024;
+
+void UniformGrid::cell_range(AABB const &box, i32 &x0, i32 &y0, i32 &x1, i32 &y1) const
+{
+	// Clamped while still a float, casting a NaN or out of range value to an int is undefined.
+	auto cell = [&](f32 v, f32 origin, i32 count) {
+		f32 const c = std::floor((v - origin) / m_cell_size);
+		if (std::isnan(c))
+			return 0;
+		return static_cast<i32>(std::clamp(c, 0.f, static_cast<f32>(count - 1)));
+	};
+	x0 = cell(box.min.x, m_bounds.min.x, m_columns);
+	y0 = cell(box.min.y, m_bounds.min.y, m_rows);
+	x1 = cell(box.max.x, m_bounds.min.x, m_columns);
+	y1 = cell(box.max.y, m_bounds.min.y, m_rows);
+}
+
+void UniformGrid::build(std::vector<AABB> const &bounds, f32 cell_size)
+{
+	m_enabled.assign(bounds.size(), 1);
+	m_items.clear();
+	m_cell_start.clear();
+	m_columns = m_rows = 0;
+	if (bounds.empty())
+		return;
+
+	m_bounds = bounds[0];
+	for (auto const &box : bounds)
+		m_bounds = AABBUnion(m_bounds, box);
+
+	f32 const width = m_bounds.max.x - m_bounds.min.x;
+	f32 const height = m_bounds.max.y - m_bounds.min.y;
+	f32 const max_cells = std::max<f32>(MIN_CELLS, bounds.size() * MAX_CELLS_PER_ITEM);
+	m_cell_size = std::max(cell_size, std::sqrt(width * height / max_cells));
+	m_columns = std::max(1, static_cast<i32>(std::ceil(width / m_cell_size)));
+	m_rows = std::max(1, static_cast<i32>(std::ceil(height / m_cell_size)));
+
+	// Count, prefix-sum, then scatter.
+	m_cell_start.assign(static_cast<usize>(m_columns) * m_rows + 1, 0);
+	for (auto const &box : bounds) {
+		i32 x0, y0, x1, y1;
+		cell_range(box, x0, y0, x1, y1);
+		for (i32 y = y0; y <= y1; y++)
+			for (i32 x = x0; x <= x1; x++)
+				m_cell_start[y * m_columns + x + 1]++;
+	}
+	for (usize i = 1; i < m_cell_start.size(); i++)
+		m_cell_start[i] += m_cell_start[i - 1];
+
+	m_items.resize(m_cell_start.back());
+	std::vector<u32> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+	for (u32 item = 0; item < bounds.size(); item++) {
+		i32 x0, y0, x1, y1;
+		cell_range(bounds[item], x0, y0, x1, y1);
+		for (i32 y = y0; y <= y1; y++)
+			for (i32 x = x0; x <= x1; x++)
+				m_items[fill[y * m_columns + x]++] = item;
+	}
+}
+
+void UniformGrid::query(AABB const &box, std::vector<u32> &out) const
+{
+	if (!m_columns || !CheckCollisionAABBs(box, m_bounds))
+		return;
+
+	i32 x0, y0, x1, y1;
+	cell_range(box, x0, y0, x1, y1);
+
+	usize const first = out.size();
+	for (i32 y = y0; y <= y1; y++) {
+		for (i32 x = x0; x <= x1; x++) {
+			usize const cell = y * m_columns + x;
+			for (u32 i = m_cell_start[cell]; i < m_cell_start[cell + 1]; i++) {
+				if (m_enabled[m_items[i]])
+					out.push_back(m_items[i]);
+			}
+		}
+	}
+
+	// Items spanning several cells show up more than once, and callers resolve in order.
+	std::sort(out.begin() + first, out.end());
+	out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+void UniformGrid::assign(Layout const &layout, std::span<u32 const> cell_starts,
+    std::span<u32 const> items, usize item_count)
+{
+	m_bounds = layout.bounds;
+	m_cell_size = layout.cell_size;
+	m_columns = layout.columns;
+	m_rows = layout.rows;
+	m_cell_start.assign(cell_starts.begin(), cell_starts.end());
+	m_items.assign(items.begin(), items.end());
+	m_enabled.assign(item_count, 1);
+}
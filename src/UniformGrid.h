@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "GameMath.h"
+#include "common.h"
+
+// Uniform grid broadphase over axis-aligned boxes. Cells are stored CSR-style, as offsets into a
+// single item array, so even a level with tens of thousands of items is a couple of allocations.
+struct UniformGrid {
+	// `cell_size` is a hint, it grows if the bounds would need an unreasonable number of cells.
+	void build(std::vector<AABB> const &bounds, f32 cell_size);
+
+	// Appends the enabled items whose cells overlap `box` to `out`, ascending and deduplicated.
+	void query(AABB const &box, std::vector<u32> &out) const;
+
+	// Disabled items stay in their cells but are skipped by query().
+	void set_enabled(u32 item, bool enabled) { m_enabled[item] = enabled; }
+	void enable_all(void) { std::fill(m_enabled.begin(), m_enabled.end(), 1); }
+
+	usize item_count(void) const { return m_enabled.size(); }
+
+	// Flat form of a built grid, used by the compiled level format to skip rebuilding it.
+	struct Layout {
+		AABB bounds;
+		f32  cell_size;
+		i32  columns;
+		i32  rows;
+	};
+	Layout              layout(void) const { return { m_bounds, m_cell_size, m_columns, m_rows }; }
+	std::span<u32 const> cell_starts(void) const { return m_cell_start; }
+	std::span<u32 const> items(void) const { return m_items; }
+	void assign(Layout const &layout, std::span<u32 const> cell_starts, std::span<u32 const> items,
+	    usize item_count);
+
+private:
+	void cell_range(AABB const &box, i32 &x0, i32 &y0, i32 &x1, i32 &y1) const;
+
+	AABB m_bounds {};
+	f32  m_cell_size = 1;
+	i32  m_columns = 0, m_rows = 0;
+
+	std::vector<u32> m_cell_start; // m_columns * m_rows + 1 offsets into m_items.
+	std::vector<u32> m_items;
+	std::vector<u8>  m_enabled;
+};
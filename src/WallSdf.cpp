@@ -0,0 +1,190 @@
+#include "WallSdf.h"
+
+#include <vector>
+
+#include <raymath.h>
+#include <rlgl.h>
+
+#include "Level.h"
+#include "Shaders.h"
+
+constexpr f32 WALL_SDF_CELL_SIZE = 64; // A hint, see UniformGrid::build().
+constexpr f32 WALL_SDF_MARGIN = 4; // Covers the antialiased fringe down to a zoom of 1/8.
+constexpr i32 WALL_SDF_TEXTURE_WIDTH = 2048;
+constexpr i32 WALL_SDF_MAX_ROWS = 2048; // ES 3 only promises 2048 texels a side.
+
+static char const *WALL_SDF_VS = R"(
+in vec3 vertexPosition;
+in vec4 vertexColor;
+
+uniform mat4 mvp;
+
+out vec2 fragWorld;
+out vec4 fragColor;
+
+void main()
+{
+	fragWorld = vertexPosition.xy;
+	fragColor = vertexColor;
+	gl_Position = mvp * vec4(vertexPosition, 1.0);
+}
+)";
+
+static char const *WALL_SDF_FS = R"(
+in vec2 fragWorld;
+in vec4 fragColor;
+
+uniform sampler2D texture0; // Cell ranges, then the segments they list, see WallSdf::build().
+uniform vec2      gridOrigin;
+uniform float     cellSize;
+uniform ivec2     gridSize;
+uniform float     radius;
+
+out vec4 finalColor;
+
+vec4 fetch(int i)
+{
+	int width = textureSize(texture0, 0).x;
+	return texelFetch(texture0, ivec2(i % width, i / width), 0);
+}
+
+void main()
+{
+	// World units per pixel, taken before any branching so the derivatives are defined.
+	float pixel = length(fwidth(fragWorld)) * 0.7071;
+
+	ivec2 cell = ivec2(floor((fragWorld - gridOrigin) / cellSize));
+	if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, gridSize)))
+		discard;
+	vec4 range = fetch(cell.y * gridSize.x + cell.x);
+
+	float distance = 1e30;
+	for (int i = int(range.x); i < int(range.y); i++) {
+		vec4  segment = fetch(i);
+		vec2  pa = fragWorld - segment.xy, ba = segment.zw - segment.xy;
+		float t = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-12), 0.0, 1.0);
+		distance = min(distance, length(pa - ba * t));
+	}
+
+	float coverage = clamp(0.5 - (distance - radius) / pixel, 0.0, 1.0);
+	if (coverage == 0.0)
+		discard;
+	finalColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
+)";
+
+static Shader s_shader {};
+static int    s_origin_loc, s_cell_size_loc, s_grid_size_loc, s_radius_loc;
+
+void WallSdf::load_shader(void)
+{
+	s_shader = LoadShaderGlsl3(WALL_SDF_VS, WALL_SDF_FS);
+	s_origin_loc = GetShaderLocation(s_shader, "gridOrigin");
+	s_cell_size_loc = GetShaderLocation(s_shader, "cellSize");
+	s_grid_size_loc = GetShaderLocation(s_shader, "gridSize");
+	s_radius_loc = GetShaderLocation(s_shader, "radius");
+}
+
+void WallSdf::unload_shader(void)
+{
+	if (s_shader.id)
+		UnloadShader(s_shader);
+	s_shader = {};
+}
+
+bool WallSdf::build(Level const &level)
+{
+	this->unload();
+	if (!s_shader.id)
+		return false;
+
+	struct Capsule {
+		Vector2 a, b;
+	};
+	std::vector<Capsule> capsules;
+	std::vector<AABB>    bounds;
+	for (auto const &wall : level.walls) {
+		if (wall.kind == Level::Wall::Kind::Door)
+			continue;
+		auto const points = level.points_of(wall);
+		for (usize i = 0; i + 1 < points.size(); i++) {
+			capsules.push_back({ points[i], points[i + 1] });
+			bounds.push_back(AABBFromSegment(
+			    points[i], points[i + 1], WALL_THICKNESS / 2.f + WALL_SDF_MARGIN));
+		}
+	}
+	if (capsules.empty())
+		return false;
+
+	UniformGrid grid;
+	grid.build(bounds, WALL_SDF_CELL_SIZE);
+	auto const starts = grid.cell_starts();
+	auto const items = grid.items();
+
+	// One texel per cell holding the range of texels its segments take up, then the segments
+	// themselves, copied into every cell they reach so the shader reads them in one go.
+	usize const cells = starts.size() - 1;
+	usize const texels = cells + items.size();
+	i32 const   rows = (texels + WALL_SDF_TEXTURE_WIDTH - 1) / WALL_SDF_TEXTURE_WIDTH;
+	if (rows > WALL_SDF_MAX_ROWS)
+		return false;
+
+	std::vector<Vector4> data(static_cast<usize>(rows) * WALL_SDF_TEXTURE_WIDTH);
+	for (usize c = 0; c < cells; c++) {
+		data[c] = { static_cast<f32>(cells + starts[c]), static_cast<f32>(cells + starts[c + 1]),
+			0, 0 };
+	}
+	for (usize i = 0; i < items.size(); i++) {
+		auto const &capsule = capsules[items[i]];
+		data[cells + i] = { capsule.a.x, capsule.a.y, capsule.b.x, capsule.b.y };
+	}
+
+	u32 const id = rlLoadTexture(
+	    data.data(), WALL_SDF_TEXTURE_WIDTH, rows, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 1);
+	if (!id)
+		return false;
+	m_texture = { id, WALL_SDF_TEXTURE_WIDTH, rows, 1, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32 };
+	// Float textures can't be filtered on ES 3, and texelFetch() needs them complete.
+	SetTextureFilter(m_texture, TEXTURE_FILTER_POINT);
+	m_layout = grid.layout();
+	return true;
+}
+
+void WallSdf::unload(void)
+{
+	if (m_texture.id)
+		UnloadTexture(m_texture);
+	m_texture = {};
+}
+
+bool WallSdf::draw(AABB const &view, Color color) const
+{
+	if (!m_texture.id)
+		return false;
+
+	AABB const box = { Vector2Max(view.min, m_layout.bounds.min),
+		Vector2Min(view.max, m_layout.bounds.max) };
+	if (box.min.x >= box.max.x || box.min.y >= box.max.y)
+		return true;
+
+	i32 const grid_size[] = { m_layout.columns, m_layout.rows };
+	f32 const radius = WALL_THICKNESS / 2.f;
+	SetShaderValue(s_shader, s_origin_loc, &m_layout.bounds.min, SHADER_UNIFORM_VEC2);
+	SetShaderValue(s_shader, s_cell_size_loc, &m_layout.cell_size, SHADER_UNIFORM_FLOAT);
+	SetShaderValue(s_shader, s_grid_size_loc, grid_size, SHADER_UNIFORM_IVEC2);
+	SetShaderValue(s_shader, s_radius_loc, &radius, SHADER_UNIFORM_FLOAT);
+
+	// One quad over the visible part of the grid, the shader does the rest.
+	BeginShaderMode(s_shader);
+	rlSetTexture(m_texture.id);
+	rlBegin(RL_QUADS);
+	rlColor4ub(color.r, color.g, color.b, color.a);
+	rlVertex2f(box.min.x, box.min.y);
+	rlVertex2f(box.min.x, box.max.y);
+	rlVertex2f(box.max.x, box.max.y);
+	rlVertex2f(box.max.x, box.min.y);
+	rlEnd();
+	rlSetTexture(0);
+	EndShaderMode();
+	return true;
+}
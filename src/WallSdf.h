@@ -0,0 +1,31 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "GameMath.h"
+#include "UniformGrid.h"
+#include "common.h"
+
+struct Level;
+
+// A level's plain walls drawn as a signed distance field. The segments are bucketed into a grid
+// and packed into a float texture, and a fragment shader takes the distance to the capsules in
+// the pixel's cell. Edges come out antialiased at any zoom without MSAA, and a joint shared by
+// two segments is one round cap rather than two overlapping ones. Doors stay meshes.
+struct WallSdf {
+	// The shader is shared by every level. Both need a GL context.
+	static void load_shader(void);
+	static void unload_shader(void);
+
+	// Returns false, leaving the walls to the meshes, if the shader didn't load or the packed
+	// grid is too big for one texture.
+	bool build(Level const &level);
+	void unload(void);
+
+	// Fills the walls under `view`, a world-space box, with `color`. Returns false if not built.
+	bool draw(AABB const &view, Color color) const;
+
+private:
+	Texture2D           m_texture {};
+	UniformGrid::Layout m_layout {};
+};
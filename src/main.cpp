@@ -1,11 +1,13 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <complex>
 #include <cstdlib>
 #include <ctime>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <raylib.h>
@@ -13,10 +15,18 @@
 
 #include "common.h"
 
+#include "AssetLoader.h"
+#include "Counters.h"
+#include "FFT.h"
 #include "GameMath.h"
 #include "GameState.h"
 #include "Gui.h"
 #include "Player.h"
+#include "Profiler.h"
+#include "Simulation.h"
+#include "SpscQueue.h"
+#include "ThreadPool.h"
+#include "WallSdf.h"
 
 #if defined(PLATFORM_WEB)
 #define CUSTOM_MODAL_DIALOGS
@@ -29,7 +39,24 @@ constexpr auto SETTINGS_H = 180;
 static constexpr auto INITIAL_SCREEN_WIDTH = 800;
 static constexpr auto INITIAL_SCREEN_HEIGHT = INITIAL_SCREEN_WIDTH;
 
+// Behind the level map. A frame of them is one batch of quads, so this can go up a lot.
+static constexpr usize MENU_PARTICLE_COUNT = 800;
+
+static constexpr f64 MAX_SIM_BACKLOG = 0.25;
+
+// The overlay averages over this window, dumps cover the last PROFILER_DUMP_SECONDS.
+static constexpr f64 PROFILER_OVERLAY_WINDOW = 1.0;
+
+// Largest audio block analysed per callback, anything past it is left out of the spectrum.
+static constexpr usize FFT_MAX_FRAMES = 8192;
+
 static void produce_frame(void);
+static void simulate_tick(f64 dt, InputState input);
+static void reset_view(void);
+static void start_replay(void);
+static void save_recording(void);
+static void dump_profile(void);
+static void render_profiler_overlay(void);
 static void slider(f32 &value, Rectangle bounds);
 
 constexpr TextureFilter TEXTURE_FILTER = TEXTURE_FILTER_BILINEAR;
@@ -43,59 +70,26 @@ static void DrawTextBoxedSelectable(Font font, char const *text, Rectangle rec,
 
 float scaling_factor = 20.0f;
 
-void fft(std::vector<std::complex<double>> &data)
-{
-	size_t const N = data.size();
-	if (N <= 1)
-		return;
-
-	std::vector<std::complex<double>> even(N / 2);
-	std::vector<std::complex<double>> odd(N / 2);
-
-	for (size_t i = 0; i < N / 2; ++i) {
-		even[i] = data[i * 2];
-		odd[i] = data[i * 2 + 1];
-	}
-
-	fft(even);
-	fft(odd);
+struct AudioBlock {
+	u32   frames;
+	float samples[FFT_MAX_FRAMES]; // Left channel.
+};
 
-	for (size_t k = 0; k < N / 2; ++k) {
-		std::complex<double> t = std::polar(1.0, -2.0 * PI * k / N) * odd[k];
-		data[k] = even[k] + t;
-		data[k + N / 2] = even[k] - t;
-	}
-}
+// Shared with the audio thread. Parameters go in through atomics and raw sample blocks come back
+// out through a lock-free queue, the spectrum itself is computed on the main thread.
+static std::atomic<float>       audio_volume = 1.0f;
+static std::atomic<bool>        audio_low_pass = false;
+static SpscQueue<AudioBlock, 8> audio_blocks;
 
-std::vector<double> perform_fft(std::vector<double> const &real_data)
-{
-	size_t N = real_data.size();
-	size_t power_of_two = 1;
-	while (power_of_two < N)
-		power_of_two <<= 1;
-
-	std::vector<std::complex<double>> complex_data(power_of_two);
-	for (size_t i = 0; i < N; ++i) {
-		complex_data[i] = real_data[i];
-	}
-
-	fft(complex_data);
-
-	std::vector<double> magnitudes(power_of_two / 2);
-	for (size_t i = 0; i < power_of_two / 2; ++i) {
-		magnitudes[i] = std::abs(complex_data[i]);
-	}
-	return magnitudes;
-}
-
-void low_pass_filter_and_fft_cb(void *buffer, unsigned int frames)
+// Runs on raylib's audio thread, so no locks, allocations or g_gs access in here.
+void low_pass_filter_cb(void *buffer, unsigned int frames)
 {
 	float       *samples = static_cast<float *>(buffer);
 	static float prev_sample_left = 0.0f;
 	static float prev_sample_right = 0.0f;
 	float const  alpha = 0.05f;
 
-	if (g_gs.current_dialog) {
+	if (audio_low_pass.load(std::memory_order_relaxed)) {
 		for (unsigned int i = 0; i < frames * 2; i += 2) {
 			samples[i] = prev_sample_left + alpha * (samples[i] - prev_sample_left);
 			prev_sample_left = samples[i];
@@ -104,36 +98,57 @@ void low_pass_filter_and_fft_cb(void *buffer, unsigned int frames)
 		}
 	}
 
-	std::vector<double> real_data(frames);
-	for (unsigned int i = 0; i < frames; i++) {
-		real_data[i] = samples[i * 2];
+	// Dropped when the main thread is behind, the visualiser can miss a block.
+	if (auto *block = audio_blocks.acquire()) {
+		block->frames = std::min<u32>(frames, FFT_MAX_FRAMES);
+		for (u32 i = 0; i < block->frames; i++)
+			block->samples[i] = samples[i * 2];
+		audio_blocks.publish();
 	}
 
-	auto magnitudes = perform_fft(real_data);
-
-	for (auto &magnitude : magnitudes) {
-		magnitude = 20 * log10(magnitude + 1e-6);
-		magnitude += 10.0;
-		magnitude *= 1.2;
+	float const volume = audio_volume.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < frames * 2; i++) {
+		samples[i] *= volume;
 	}
+}
+
+static FFT    fft;
+static double fft_magnitudes[FFT_MAX_FRAMES / 2];
+
+static ThreadPool  pool;
+static AssetLoader assets;
 
-	size_t const              bin_size = magnitudes.size() / NUM_BARS;
-	static std::vector<float> smoothed_heights(NUM_BARS, 0.0f);
-	for (size_t i = 0; i < NUM_BARS; i++) {
-		float avg_magnitude = 0.0f;
-		for (size_t j = 0; j < bin_size; j++) {
-			avg_magnitude += magnitudes[i * bin_size + j];
+// Drains the blocks the audio thread published since last frame into g_gs.bar_heights.
+static void update_spectrum(void)
+{
+	audio_volume.store(g_gs.music_volume, std::memory_order_relaxed);
+	audio_low_pass.store(g_gs.current_dialog != nullptr, std::memory_order_relaxed);
+
+	static float smoothed_heights[NUM_BARS] = {};
+	while (auto const *block = audio_blocks.peek()) {
+		usize const bins = fft.perform(block->samples, block->frames, 1, fft_magnitudes);
+		audio_blocks.release();
+
+		for (usize i = 0; i < bins; i++) {
+			auto &magnitude = fft_magnitudes[i];
+			magnitude = 20 * log10(magnitude + 1e-6);
+			magnitude += 10.0;
+			magnitude *= 1.2;
 		}
-		avg_magnitude /= bin_size;
 
-		float const smoothing_factor = 0.8f;
-		smoothed_heights[i]
-		    = smoothing_factor * smoothed_heights[i] + (1.0f - smoothing_factor) * avg_magnitude;
-		g_gs.bar_heights[i] = std::max(0.0f, smoothed_heights[i] * scaling_factor);
-	}
+		size_t const bin_size = bins / NUM_BARS;
+		for (size_t i = 0; i < NUM_BARS; i++) {
+			float avg_magnitude = 0.0f;
+			for (size_t j = 0; j < bin_size; j++) {
+				avg_magnitude += fft_magnitudes[i * bin_size + j];
+			}
+			avg_magnitude /= bin_size;
 
-	for (size_t i = 0; i < frames * 2; i++) {
-		samples[i] *= g_gs.music_volume;
+			float const smoothing_factor = 0.8f;
+			smoothed_heights[i] = smoothing_factor * smoothed_heights[i]
+			    + (1.0f - smoothing_factor) * avg_magnitude;
+			g_gs.bar_heights[i] = std::max(0.0f, smoothed_heights[i] * scaling_factor);
+		}
 	}
 }
 
@@ -142,28 +157,32 @@ float angle_from_center(Vector2 const &center, Vector2 const &point)
 	return atan2(point.y - center.y, point.x - center.x);
 }
 
-usize number_of_files_in_directory(std::filesystem::path path)
-{
-	using std::filesystem::directory_iterator;
-	return std::distance(directory_iterator(path), directory_iterator {});
-}
-
 int main(int argc, char **argv)
 {
 	SetRandomSeed(time(nullptr));
 
 	g_gs.settings_y = INITIAL_SCREEN_HEIGHT;
 
-	for (usize i = 0; i < 800; i++) {
-		g_gs.menu_particles.push_back({
-		    static_cast<float>(GetRandomValue(0, INITIAL_SCREEN_WIDTH)),
-		    static_cast<float>(GetRandomValue(0, INITIAL_SCREEN_HEIGHT)),
-		});
-		g_gs.menu_particle_speeds.push_back(GetRandomValue(500, 700));
-	}
-
-	if (argc != 1) {
-		g_gs.cheat = 1;
+	g_gs.menu_particles.spawn(
+	    MENU_PARTICLE_COUNT, INITIAL_SCREEN_WIDTH, INITIAL_SCREEN_HEIGHT, time(nullptr));
+
+	std::optional<std::filesystem::path> replay_path;
+	bool                                 msaa = true;
+	for (int i = 1; i < argc; i++) {
+		std::string_view const arg = argv[i];
+		if (arg == "--replay" && i + 1 < argc) {
+			replay_path = argv[++i];
+		} else if (arg == "--profile") {
+			g_profiler.set_enabled(true);
+		} else if (arg == "--no-msaa") {
+			msaa = false; // Walls antialias themselves through WallSdf, this saves fill rate.
+		} else if (arg == "--cheat") {
+			g_gs.cheat = 1;
+		} else {
+			std::cerr << "Unknown argument: " << arg << "\nUsage: " << argv[0]
+			          << " [--replay <file>] [--profile] [--no-msaa] [--cheat]" << std::endl;
+			return 1;
+		}
 	}
 #ifdef _DEBUG
 	g_gs.cheat = 1;
@@ -177,11 +196,8 @@ int main(int argc, char **argv)
 		}
 
 		g_gs.palette = ColorPalette::generate();
-		auto const dir_files = number_of_files_in_directory(RESOURCES_PATH "levels");
-		for (int i = 0; i < dir_files; i++) {
-			g_gs.levels.push_back(
-			    Level::read_from_file(TextFormat(RESOURCES_PATH "levels/Level%d.json", i)));
-		}
+		if (replay_path)
+			g_gs.replay = Replay::read_from_file(*replay_path);
 	} catch (std::exception &e) {
 		std::cout << e.what() << std::endl;
 		return 1;
@@ -192,28 +208,24 @@ int main(int argc, char **argv)
 #endif
 
 #if !defined(PLATFORM_WEB)
-	SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_MSAA_4X_HINT);
+	SetConfigFlags(FLAG_WINDOW_RESIZABLE | (msaa ? FLAG_MSAA_4X_HINT : 0));
 #endif
 	InitWindow(INITIAL_SCREEN_WIDTH, INITIAL_SCREEN_HEIGHT, "ByteRacer");
 	InitAudioDevice();
+	g_gs.sprites.load();
+	WallSdf::load_shader();
 
-	constexpr auto SONGS = 6;
-	for (usize i = 0; i < SONGS; i++) {
-		auto song = LoadMusicStream(TextFormat(RESOURCES_PATH "music_%d.mp3", i));
-		AttachAudioStreamProcessor(song.stream, low_pass_filter_and_fft_cb);
-		g_gs.music.push_back(song);
-	}
-	srand(time(nullptr));
-	g_gs.current_song = rand() % SONGS;
-	g_gs.explosion = LoadSound(RESOURCES_PATH "explosion.mp3");
-	g_gs.pickup = LoadSound(RESOURCES_PATH "pickup.wav");
-	g_gs.wall_hit = LoadSound(RESOURCES_PATH "wall_hit.wav");
-	PlayMusicStream(g_gs.music[g_gs.current_song]);
+	fft.resize(FFT_MAX_FRAMES);
+	g_profiler.name_thread("main");
 
-	g_gs.spritesheet = LoadTexture("resources/spritesheet.png");
-	g_gs.settings_icon = LoadTexture("resources/settings.png");
-	g_gs.read_dialogs_from_file("resources/Dialog.json");
-	g_gs.font = LoadFontEx("resources/SpaceMono-Regular.ttf", 60, nullptr, 0);
+	g_gs.levels.on_evict = [](Level &level) {
+		level.mesh.unload();
+		g_gs.level_layer.forget(level);
+	};
+	// produce_frame() polls the loader and shows the menu once its own assets are in.
+	assets.start(pool, low_pass_filter_cb);
+	srand(time(nullptr));
+	g_gs.current_song = rand() % g_gs.music.size();
 
 #if defined(PLATFORM_WEB)
 	emscripten_set_main_loop(produce_frame, 0, 1);
@@ -223,6 +235,11 @@ int main(int argc, char **argv)
 		produce_frame();
 #endif
 
+	g_gs.levels.unload_all();
+	g_gs.level_layer.unload();
+	g_gs.sprites.unload();
+	WallSdf::unload_shader();
+
 	CloseWindow();
 
 	return 0;
@@ -233,56 +250,170 @@ float lerp(float a, float b, float f) { return a + f * (b - a); }
 void set_level(usize i, bool reset_dialog)
 {
 	g_gs.current_level = i;
-	auto &lvl = *g_gs.level();
-	for (auto &wall : lvl.walls) {
-		wall.time_since_trigger = -1;
-	}
-	for (auto &zone : lvl.zones) {
-		if (reset_dialog)
-			zone.time_since_trigger = -1;
+	auto &lvl = g_gs.levels.acquire(i);
+	if (reset_dialog && !g_gs.replay)
+		g_gs.recording = { g_gs.sim_rate, static_cast<u32>(i), lvl.name, {} };
+	g_gs.sim.start(lvl, reset_dialog);
+	g_gs.pending_presses = 0;
+	reset_view();
+}
+
+// Snaps the camera to the player, after the simulation (re)started.
+static void reset_view(void)
+{
+	g_gs.camera.target = g_gs.sim.player.position;
+	g_gs.camera.zoom = 2;
+	g_gs.camera.rotation = -g_gs.sim.player.angle * RAD2DEG - 90;
+	g_gs.previous_camera = g_gs.camera;
+	g_gs.sim_accumulator = 0;
+}
+
+// Advances the level by one fixed step. All game logic lives in Simulation::tick(), this only
+// records the input and turns the tick's events into sounds, dialogs and camera movement.
+static void simulate_tick(f64 dt, InputState input)
+{
+	if (!g_gs.replay)
+		g_gs.recording.ticks.push_back(input);
+
+	g_gs.previous_camera = g_gs.camera;
+
+	auto &sim = g_gs.sim;
+	sim.tick(dt, input);
+
+	if (sim.events & Simulation::WallHit)
+		PlaySound(g_gs.wall_hit);
+	if (sim.events & Simulation::Pickup)
+		PlaySound(g_gs.pickup);
+	if (sim.events & Simulation::Death)
+		PlaySound(g_gs.explosion);
+	if (sim.events & Simulation::Restart)
+		reset_view();
+	if (sim.events & Simulation::Dialog)
+		g_gs.show_dialog(sim.level->name, sim.dialog_index);
+	if (sim.events & Simulation::Completed) {
+		auto &entry = g_gs.levels.entry(*g_gs.current_level);
+		entry.collected_files = sim.collected_files;
+		entry.total_files = sim.total_files;
+		save_recording();
 	}
-	for (auto &pickup : lvl.pickups) {
-		pickup.time_since_pickup = -1;
+
+	g_gs.camera.target.x = lerp(g_gs.camera.target.x, sim.player.position.x, dt * 4);
+	g_gs.camera.target.y = lerp(g_gs.camera.target.y, sim.player.position.y, dt * 4);
+	g_gs.camera.rotation = lerp(g_gs.camera.rotation, -(sim.player.angle * RAD2DEG) - 90.0,
+	    dt * (g_gs.cam_smooth ? 2 : 5));
+}
+
+static void start_replay(void)
+{
+	auto const &replay = *g_gs.replay;
+	if (replay.level >= g_gs.levels.size()
+	    || g_gs.levels.entry(replay.level).name != replay.level_name) {
+		std::cout << "Replay is for level " << replay.level_name << ", which isn't installed."
+		          << std::endl;
+		g_gs.replay.reset();
+		return;
 	}
 
-	g_gs.player.position = g_gs.level()->start_position;
-	g_gs.player.velocity = { 0, 0 };
-	g_gs.player.angle = g_gs.level()->start_angle;
-	g_gs.player.trail.clear();
-	g_gs.player.health = PLAYER_MAX_HP;
+	set_level(replay.level, true);
+}
 
-	g_gs.camera.target = g_gs.player.position;
-	g_gs.camera.zoom = 2;
-	g_gs.camera.rotation = -g_gs.player.angle * RAD2DEG - 90;
+static void save_recording(void)
+{
+	// A zero sim rate means nothing was recorded, e.g. the level was entered by a replay.
+	if (g_gs.replay || !g_gs.recording.sim_rate)
+		return;
 
-	g_gs.time_spent = 0;
-	g_gs.completion_time = 0;
+	// Losing a replay isn't worth interrupting the run over, so errors are only logged.
+	try {
+		std::filesystem::create_directories("replays");
+		auto const &recording = g_gs.recording;
+		recording.export_to_file(TextFormat("replays/%s-%lld.brr", recording.level_name.c_str(),
+		    static_cast<long long>(time(nullptr))));
+	} catch (std::exception &e) {
+		TraceLog(LOG_WARNING, "Failed to save replay: %s", e.what());
+	}
+}
+
+// Writes the trace along with the counters CSV for the same frames. Dumps are written whether or
+// not the overlay is up, F4 starts profiling if it's off.
+static void dump_profile(void)
+{
+	if (!g_profiler.enabled()) {
+		g_profiler.set_enabled(true);
+		TraceLog(LOG_INFO, "Profiling started, press F4 again to save a trace");
+		return;
+	}
+
+	try {
+		std::filesystem::create_directories("profiles");
+		auto const now = static_cast<long long>(time(nullptr));
+		g_profiler.export_chrome_trace(
+		    TextFormat("profiles/trace-%lld.json", now), PROFILER_DUMP_SECONDS);
+		g_counters.export_csv(TextFormat("profiles/counters-%lld.csv", now));
+		TraceLog(LOG_INFO, "Saved profile to profiles/trace-%lld.json", now);
+	} catch (std::exception &e) {
+		TraceLog(LOG_WARNING, "Failed to save profile: %s", e.what());
+	}
 }
 
 static bool    dragging = false;
 static Vector2 prev_mouse_pos = { 0, 0 };
+static bool    show_profiler = false;
 void           produce_frame(void)
 {
-	if (!IsMusicStreamPlaying(g_gs.music[g_gs.current_song])) {
-		StopMusicStream(g_gs.music[g_gs.current_song]);
-		g_gs.current_song++;
-		g_gs.current_song %= g_gs.music.size();
-		SeekMusicStream(g_gs.music[g_gs.current_song], 0);
-		PlayMusicStream(g_gs.music[g_gs.current_song]);
+	PROFILE_SCOPE("frame");
+	defer(g_counters.end_frame());
+
+	if (!assets.done()) {
+		PROFILE_SCOPE("assets");
+		try {
+			assets.poll();
+		} catch (std::exception &e) {
+			std::cout << e.what() << std::endl;
+			std::exit(1);
+		}
+		if (!assets.menu_ready()) {
+			BeginDrawing();
+			ClearBackground(g_gs.palette.menu_background);
+			EndDrawing();
+			return;
+		}
+	}
+
+	{
+		PROFILE_SCOPE("music");
+		// Songs still loading are skipped over, the loader starts the current one once it's in.
+		if (IsMusicReady(g_gs.music[g_gs.current_song])) {
+			if (!IsMusicStreamPlaying(g_gs.music[g_gs.current_song])) {
+				StopMusicStream(g_gs.music[g_gs.current_song]);
+				g_gs.current_song++;
+				g_gs.current_song %= g_gs.music.size();
+				SeekMusicStream(g_gs.music[g_gs.current_song], 0);
+				PlayMusicStream(g_gs.music[g_gs.current_song]);
+			}
+			UpdateMusicStream(g_gs.music[g_gs.current_song]);
+		}
+		update_spectrum();
 	}
-	UpdateMusicStream(g_gs.music[g_gs.current_song]);
 
 	double dt = GetFrameTime();
 
-	if (IsKeyPressed(KEY_R)) {
-		set_level(*g_gs.current_level, false);
-	}
+	if (g_gs.replay && !g_gs.replay_tick && !g_gs.current_level)
+		start_replay();
 #ifdef _DEBUG
 	if (IsKeyPressed(KEY_P)) {
 		g_gs.palette = ColorPalette::generate();
 	}
 #endif
 
+	if (IsKeyPressed(KEY_F3)) {
+		show_profiler = !show_profiler;
+		if (show_profiler)
+			g_profiler.set_enabled(true);
+	}
+	if (IsKeyPressed(KEY_F4))
+		dump_profile();
+
 	if (IsKeyPressed(KEY_M)) {
 		StopMusicStream(g_gs.music[g_gs.current_song]);
 		g_gs.current_song++;
@@ -295,79 +426,48 @@ void           produce_frame(void)
 	g_gs.widthf = static_cast<float>(g_gs.width);
 	g_gs.heightf = static_cast<float>(g_gs.height);
 
-	if (g_gs.level() && !g_gs.current_dialog) {
-		g_gs.time_spent += dt;
-
-		g_gs.player.update(dt);
+	// Presses wait for the next tick, frames that run none or have a dialog open would drop them.
+	InputState const keys = InputState::poll();
+	if (g_gs.level())
+		g_gs.pending_presses |= keys.bits & InputState::Restart;
 
-		for (auto &pickup : g_gs.level()->pickups) {
-			if (pickup.time_since_pickup != -1) {
-				pickup.time_since_pickup += dt;
-			} else {
-				if (CheckCollisionCircles(
-				        g_gs.player.position, PLAYER_RADIUS, pickup.position, PICKUP_RADIUS)) {
-					pickup.time_since_pickup = 0;
-					g_gs.player.trail.push_back(
-					    Player::TrailPickup { &pickup, g_gs.player.get_next_trail_position() });
-					PlaySound(g_gs.pickup);
-				}
-			}
-		}
+	if (g_gs.level() && !g_gs.current_dialog) {
+		if (IsKeyPressed(KEY_C))
+			g_gs.cam_smooth = !g_gs.cam_smooth;
 
-		bool in_danger = false;
-		for (auto &zone : g_gs.level()->zones) {
-			if (CheckCollisionCirclePoly(g_gs.player.position, PLAYER_RADIUS, zone.points)) {
-				if (!in_danger && zone.kind == Level::Zone::Kind::Danger) {
-					in_danger = true;
-				} else if (zone.kind == Level::Zone::Kind::End) {
-					if (!g_gs.completion_time) {
-						g_gs.completion_time = g_gs.time_spent;
-						g_gs.level()->collected_files = 0;
-						g_gs.level()->total_files = 0;
-						for (auto &pickup : g_gs.level()->pickups) {
-							if (pickup.kind != Level::Pickup::Kind::File)
-								continue;
-							g_gs.level()->total_files++;
-							g_gs.level()->collected_files += pickup.time_since_pickup != -1;
-						}
-					}
-				} else if (zone.kind == Level::Zone::Kind::DialogTrigger) {
-					if (zone.time_since_trigger == -1) {
-						zone.time_since_trigger = 0;
-						g_gs.show_dialog(g_gs.level()->name, zone.value.dialog_index);
-					}
+		// A replay runs at the rate it was recorded at, the game's own is left alone for after it.
+		f64 const step = 1.0 / (g_gs.replay ? g_gs.replay->sim_rate : g_gs.sim_rate);
+		// Clamped so a long hitch doesn't turn into an ever growing backlog of ticks.
+		g_gs.sim_accumulator = std::min(g_gs.sim_accumulator + dt, MAX_SIM_BACKLOG);
+		// Held keys apply to every tick this frame, a restart press only to the first.
+		PROFILE_SCOPE("simulate");
+		InputState input = { static_cast<u8>(
+		    (keys.bits & ~InputState::Restart) | g_gs.pending_presses) };
+		while (g_gs.sim_accumulator >= step) {
+			if (g_gs.replay) {
+				auto const &ticks = g_gs.replay->ticks;
+				if (g_gs.replay_tick < ticks.size()) {
+					input = ticks[g_gs.replay_tick++];
+				} else {
+					input = {};
+					g_gs.replay.reset(); // Played out, the keyboard takes over from next frame.
 				}
 			}
-
-			if (zone.kind == Level::Zone::Kind::DialogTrigger) {
-				if (zone.time_since_trigger != -1) {
-					zone.time_since_trigger += dt;
-				}
+			simulate_tick(step, input);
+			input.bits &= ~InputState::Restart;
+			g_gs.pending_presses = 0;
+			g_gs.sim_accumulator -= step;
+			// Replays skip dialogs, the simulation doesn't advance while one is open anyway.
+			if (g_gs.replay)
+				g_gs.current_dialog = nullptr;
+			if (!g_gs.level() || g_gs.current_dialog) {
+				// Frozen until it closes, catching up afterwards or blending past the last tick
+				// would both be wrong.
+				g_gs.sim_accumulator = 0;
+				break;
 			}
 		}
-
-		if (in_danger)
-			g_gs.player.health -= dt;
-		else
-			g_gs.player.health += dt;
-
-		if (g_gs.player.health > PLAYER_MAX_HP)
-			g_gs.player.health = PLAYER_MAX_HP;
-		else if (g_gs.player.health < 0) {
-			set_level(*g_gs.current_level, false);
-			PlaySound(g_gs.explosion);
-		}
-
-
-		if (IsKeyPressed(KEY_C))
-			g_gs.cam_smooth = !g_gs.cam_smooth;
-
-		g_gs.camera.offset.x = g_gs.widthf / 2.;
-		g_gs.camera.offset.y = g_gs.heightf / 2.;
-		g_gs.camera.target.x = lerp(g_gs.camera.target.x, g_gs.player.position.x, dt * 4);
-		g_gs.camera.target.y = lerp(g_gs.camera.target.y, g_gs.player.position.y, dt * 4);
-		g_gs.camera.rotation
-			= lerp(g_gs.camera.rotation, -(g_gs.player.angle * RAD2DEG) - 90.0, dt * (g_gs.cam_smooth ? 2 : 5));
+		g_gs.sim_alpha = std::clamp(g_gs.sim_accumulator / step, 0.0, 1.0);
 	} else {
 		constexpr Rectangle TARGET_SETTINGS_BUTTON = { 20, 20, 64, 64 };
 
@@ -406,7 +506,8 @@ void           produce_frame(void)
 				g_gs.target_menu_scroll = 0;
 		}
 
-		for (auto &level : g_gs.levels) {
+		for (usize l = 0; l < g_gs.levels.size(); l++) {
+			auto &level = g_gs.levels.entry(l);
 			if (g_gs.cheat)
 				break;
 
@@ -440,24 +541,35 @@ void           produce_frame(void)
 		}
 
 		if (g_gs.level()) {
-			g_gs.level()->render(&g_gs.camera);
-			if (g_gs.player.health != PLAYER_MAX_HP) {
+			// The simulation runs ahead of what is drawn, blend the last two ticks together.
+			Camera2D view = g_gs.camera;
+			view.offset = { g_gs.widthf / 2, g_gs.heightf / 2 };
+			auto const &previous = g_gs.previous_camera;
+			view.target = Vector2Lerp(previous.target, g_gs.camera.target, g_gs.sim_alpha);
+			view.rotation = Lerp(previous.rotation, g_gs.camera.rotation, g_gs.sim_alpha);
+			{
+				PROFILE_SCOPE("level_render");
+				g_gs.level()->render(&view);
+			}
+
+			PROFILE_SCOPE("hud");
+			if (g_gs.sim.player.health != PLAYER_MAX_HP) {
 				constexpr auto BAR_WIDTH = 30.f;
 				Vector2        hp_position = {
                     static_cast<float>(g_gs.widthf / 2),
                     static_cast<float>(g_gs.heightf * 0.8),
 				};
-				Vector2 left = { hp_position.x - BAR_WIDTH * (g_gs.player.health / PLAYER_MAX_HP),
+				Vector2 left = { hp_position.x - BAR_WIDTH * (g_gs.sim.player.health / PLAYER_MAX_HP),
 					hp_position.y };
-				Vector2 right = { hp_position.x + BAR_WIDTH * (g_gs.player.health / PLAYER_MAX_HP),
+				Vector2 right = { hp_position.x + BAR_WIDTH * (g_gs.sim.player.health / PLAYER_MAX_HP),
 					hp_position.y };
 				DrawLineEx(left, right, 3, g_gs.palette.primary);
 			}
 
-			if (g_gs.completion_time)
-				g_gs.level()->render_hud(g_gs.time_spent - g_gs.completion_time);
+			if (g_gs.sim.completion_time)
+				g_gs.level()->render_hud(g_gs.sim.time_spent - g_gs.sim.completion_time);
 			else {
-				auto text = format_time(g_gs.time_spent);
+				auto text = format_time(g_gs.sim.time_spent);
 				int  w = MeasureTextEx(g_gs.font, text, 40, 3).x;
 				DrawTextEx(
 				    g_gs.font, text, { g_gs.widthf / 2 - w / 2, 20 }, 40, 3, g_gs.palette.primary);
@@ -467,7 +579,7 @@ void           produce_frame(void)
 			int   i = 1;
 
 			g_gs.total_collected_files = 0;
-			for (auto const &level : g_gs.levels) {
+			for (auto const &level : g_gs.levels.entries()) {
 				g_gs.total_collected_files += level.collected_files;
 			}
 
@@ -476,21 +588,14 @@ void           produce_frame(void)
 			constexpr auto PADDING = 20;
 			constexpr auto FONT_SIZE = BUTTON_SIZE * .95;
 
-			usize i2 = 0;
-			for (auto &particle : g_gs.menu_particles) {
-				particle.x -= dt * g_gs.menu_particle_speeds[i2];
-				if (particle.x < 0) {
-					particle.x = g_gs.widthf + particle.x;
-					particle.y = static_cast<float>(GetRandomValue(0, g_gs.heightf));
-					g_gs.menu_particle_speeds[i2] = GetRandomValue(500, 700);
-				}
-
-				DrawRectangle(particle.x, particle.y, 20, 2, g_gs.palette.game_background);
-				i2++;
+			{
+				PROFILE_SCOPE("menu_particles");
+				g_gs.menu_particles.update(dt, g_gs.widthf, g_gs.heightf);
+				g_gs.menu_particles.draw(g_gs.palette.game_background);
 			}
 
 			Vector2 prev;
-			for (auto const &level : g_gs.levels) {
+			for (auto const &level : g_gs.levels.entries()) {
 				if (level.name == "final")
 					continue;
 
@@ -557,6 +662,7 @@ void           produce_frame(void)
 				t += PI / 2;
 				i++;
 			}
+			g_gs.flush_sprites(); // The file icons, under the settings panel.
 
 			{
 				g_gs.settings_y += 2500 * dt * (g_gs.settings_open ? -1 : 1);
@@ -617,6 +723,7 @@ void           produce_frame(void)
 		}
 
 		if (g_gs.current_dialog) {
+			PROFILE_SCOPE("dialog");
 			auto const height = g_gs.heightf * .3;
 			auto      &y = g_gs.dialog_box_y;
 
@@ -658,10 +765,14 @@ void           produce_frame(void)
 			    DIALOG_SIZE, DIALOG_SPACING, true, g_gs.palette.primary);
 		}
 
+		if (show_profiler)
+			render_profiler_overlay();
+
 #ifdef _DEBUG
 		DrawFPS(20, 20);
 #endif
 	}
+	PROFILE_SCOPE("present"); // Includes waiting on vsync.
 	EndDrawing();
 }
 
@@ -687,6 +798,54 @@ static void slider(f32 &value, Rectangle bounds)
 	}
 }
 
+// Rolling per-scope timings in the top right corner, per frame over PROFILER_OVERLAY_WINDOW, and
+// the frame counters over their window below them.
+static void render_profiler_overlay(void)
+{
+	constexpr auto WIDTH = 360;
+	constexpr auto FONT_SIZE = 18;
+	constexpr auto LINE_H = 20;
+	constexpr auto PADDING = 8;
+
+	u32        frames;
+	auto const stats = g_profiler.summarize(PROFILER_OVERLAY_WINDOW, "frame", frames);
+	frames = std::max<u32>(frames, 1);
+
+	Rectangle const rec = {
+		g_gs.widthf - WIDTH - 20,
+		20,
+		WIDTH,
+		static_cast<float>(PADDING * 3 + LINE_H * (stats.size() + COUNTER_COUNT + 2)),
+	};
+	DrawRectangleRec(rec, ColorAlpha(g_gs.palette.menu_background, .85f));
+	DrawRectangleLinesEx(rec, BORDER_WIDTH, g_gs.palette.primary);
+
+	Vector2 pos = { rec.x + PADDING, rec.y + PADDING };
+	DrawTextEx(g_gs.font, TextFormat("%-15s %8s %8s", "scope", "ms/frame", "max ms"), pos,
+	    FONT_SIZE, 0, g_gs.palette.primary);
+	for (auto const &scope : stats) {
+		pos.y += LINE_H;
+		DrawTextEx(g_gs.font,
+		    TextFormat("%-15s %8.2f %8.2f", scope.name, scope.total_ms / frames, scope.max_ms),
+		    pos, FONT_SIZE, 0, g_gs.palette.primary);
+	}
+
+	pos.y += LINE_H + PADDING;
+	DrawTextEx(g_gs.font, TextFormat("%-15s %8s %8s %8s", "counter", "last", "p99", "max"), pos,
+	    FONT_SIZE, 0, g_gs.palette.primary);
+	for (usize i = 0; i < COUNTER_COUNT; i++) {
+		auto const counter = static_cast<Counter>(i);
+		auto const summary = g_counters.summarize(counter);
+		pos.y += LINE_H;
+		DrawTextEx(g_gs.font,
+		    TextFormat("%-15s %8llu %8llu %8llu", counter_name(counter),
+		        static_cast<unsigned long long>(summary.last),
+		        static_cast<unsigned long long>(summary.p99),
+		        static_cast<unsigned long long>(summary.max)),
+		    pos, FONT_SIZE, 0, g_gs.palette.primary);
+	}
+}
+
 // Shamelessly stolen from Raylib examples :^)
 
 static void DrawTextBoxed(Font font, char const *text, Rectangle rec, float fontSize, float spacing,
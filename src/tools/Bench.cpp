@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <polypartition.h>
+#include <raymath.h>
+
+#include "FFT.h"
+#include "GameMath.h"
+#include "LevelCatalogue.h"
+#include "LevelGenerator.h"
+#include "Player.h"
+#include "SegmentKernel.h"
+
+// Microbenchmarks for the collision, triangulation, level loading and FFT paths, run against the
+// shipped levels and mazes from LevelGenerator at 10, 100 and 1000 times their size. Results are
+// written as JSON, and can be compared against a previous run to catch regressions.
+//
+//     Bench [--levels <dir>] [--filter <text>] [--out <file>]
+//           [--compare <baseline>] [--threshold <percent>]
+
+using json = nlohmann::json;
+
+constexpr auto SAMPLES = 5;
+constexpr auto SAMPLE_SECONDS = 0.05;
+constexpr auto DEFAULT_THRESHOLD = 10.0; // Percent slower than the baseline that fails --compare.
+constexpr auto PROBE_POINTS = 256;
+constexpr auto SIM_RATE = 120;
+constexpr u32  STRESS_SCALES[] = { 10, 100, 1000 }; // Times the content of a shipped level.
+
+// Keeps results alive so the optimiser can't drop the work that produced them.
+static volatile u64 g_sink;
+
+struct Bench {
+	std::string name;
+	f64         ns_per_op;
+	u64         ops_per_sample;
+};
+
+struct Runner {
+	std::string        filter;
+	std::vector<Bench> results;
+
+	// `op` does one unit of work per call. Each sample runs it for about SAMPLE_SECONDS and the
+	// median is kept, which is steadier than the mean against a busy machine.
+	void run(std::string const &name, std::function<void(void)> const &op)
+	{
+		if (!this->filter.empty() && name.find(this->filter) == std::string::npos)
+			return;
+
+		using clock = std::chrono::steady_clock;
+
+		u64 ops = 1;
+		for (;;) {
+			auto const start = clock::now();
+			for (u64 i = 0; i < ops; i++)
+				op();
+			auto const elapsed = std::chrono::duration<f64>(clock::now() - start).count();
+			if (elapsed >= SAMPLE_SECONDS / 4) {
+				ops = std::max<u64>(1, ops * SAMPLE_SECONDS / elapsed);
+				break;
+			}
+			ops *= 2;
+		}
+
+		std::vector<f64> samples;
+		for (int s = 0; s < SAMPLES; s++) {
+			auto const start = clock::now();
+			for (u64 i = 0; i < ops; i++)
+				op();
+			auto const elapsed = std::chrono::duration<f64, std::nano>(clock::now() - start);
+			samples.push_back(elapsed.count() / ops);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		this->results.push_back({ name, samples[SAMPLES / 2], ops });
+		std::fprintf(stderr, "%-48s %14.1f ns\n", name.c_str(), samples[SAMPLES / 2]);
+	}
+};
+
+static std::vector<Vector2> probe_points(Level const &level)
+{
+	AABB bounds = { level.start_position, level.start_position };
+	for (auto const &wall : level.walls)
+		bounds = AABBUnion(bounds, AABBFromPoints(level.points_of(wall)));
+	for (auto const &zone : level.zones)
+		bounds = AABBUnion(bounds, zone.bounds);
+
+	std::mt19937                          rng(PROBE_POINTS);
+	std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x);
+	std::uniform_real_distribution<float> y(bounds.min.y, bounds.max.y);
+	std::vector<Vector2>                  points(PROBE_POINTS);
+	for (auto &point : points)
+		point = { x(rng), y(rng) };
+	return points;
+}
+
+static TPPLPoly to_poly(std::span<Vector2 const> points)
+{
+	TPPLPoly poly;
+	poly.Init(points.size());
+	for (usize i = 0; i < points.size(); i++) {
+		poly[i].x = points[i].x;
+		poly[i].y = points[i].y;
+		poly[i].id = i;
+	}
+	poly.SetOrientation(TPPL_ORIENTATION_CCW);
+	return poly;
+}
+
+static void bench_level(Runner &runner, Level const &level, json const &source)
+{
+	auto const &name = level.name;
+	auto const  probes = probe_points(level);
+
+	runner.run("circle_poly/" + name, [&] {
+		u64 hits = 0;
+		for (auto const &zone : level.zones) {
+			for (auto const probe : probes)
+				hits += CheckCollisionCirclePoly(probe, PLAYER_RADIUS, level.points_of(zone));
+		}
+		g_sink = g_sink + hits;
+	});
+
+	runner.run("closest_point/" + name, [&] {
+		auto const &segments = level.segments;
+		f32         sum = 0;
+		for (u32 s = 0; s < segments.size(); s++) {
+			Vector2 const start = { segments.start_x[s], segments.start_y[s] };
+			Vector2 const end = { start.x + segments.dir_x[s], start.y + segments.dir_y[s] };
+			for (usize p = 0; p < probes.size(); p += 16) {
+				auto const closest = ClosestPointOnSegment(probes[p], start, end);
+				sum += closest.x + closest.y;
+			}
+		}
+		g_sink = g_sink + static_cast<u64>(sum);
+	});
+
+	// The same probes and segments as closest_point, through the vectorised kernel.
+	std::vector<u32> all_segments(level.segments.size());
+	std::iota(all_segments.begin(), all_segments.end(), 0);
+	runner.run("segment_kernel/" + name, [&] {
+		std::vector<SegmentHit> hits;
+		f32                     sum = 0;
+		for (usize p = 0; p < probes.size(); p += 16) {
+			hits.clear();
+			CollideCircleSegments(probes[p], PLAYER_RADIUS, level.segments, all_segments, hits);
+			for (auto const &hit : hits)
+				sum += hit.distance_sq;
+		}
+		g_sink = g_sink + static_cast<u64>(sum);
+	});
+
+	{
+		// Holds thrust and weaves, restarting every few seconds so the run stays in the level.
+		Level  copy = level;
+		Player player;
+		u32    tick = 0;
+		runner.run("player_update/" + name, [&] {
+			if (tick % (SIM_RATE * 4) == 0) {
+				copy.reset_doors();
+				player = Player();
+				player.position = player.previous_position = copy.start_position;
+				player.angle = copy.start_angle;
+			}
+			InputState input;
+			input.bits = InputState::Thrust;
+			input.bits |= (tick / SIM_RATE) % 2 ? InputState::Left : InputState::Right;
+			player.update(copy, input, 1.0 / SIM_RATE);
+			tick++;
+		});
+		g_sink = g_sink + static_cast<u64>(player.position.x);
+	}
+
+	std::vector<TPPLPoly> polys;
+	for (auto const &zone : level.zones) {
+		if (zone.point_count >= 3)
+			polys.push_back(to_poly(level.points_of(zone)));
+	}
+	auto const triangulate = [&](char const *method, auto &&fn) {
+		runner.run(std::string("triangulate_") + method + "/" + name, [&] {
+			TPPLPartition partition;
+			u64           triangles = 0;
+			for (auto &poly : polys) {
+				std::list<TPPLPoly> out;
+				fn(partition, poly, out);
+				triangles += out.size();
+			}
+			g_sink = g_sink + triangles;
+		});
+	};
+	triangulate("ec", [](auto &p, auto &poly, auto &out) { p.Triangulate_EC(&poly, &out); });
+	triangulate("mono", [](auto &p, auto &poly, auto &out) { p.Triangulate_MONO(&poly, &out); });
+	triangulate("opt", [](auto &p, auto &poly, auto &out) { p.Triangulate_OPT(&poly, &out); });
+
+	{
+		Level copy = level;
+		runner.run("serialize/" + name, [&] { g_sink = g_sink + copy.serialize().size(); });
+	}
+	{
+		json data = source;
+		runner.run("deserialize/" + name,
+		    [&] { g_sink = g_sink + Level::deserialize(data).segments.size(); });
+	}
+}
+
+static void bench_fft(Runner &runner)
+{
+	std::mt19937                          rng(0);
+	std::uniform_real_distribution<float> sample(-1, 1);
+
+	for (usize const size : { 512, 2048, 8192 }) {
+		// Interleaved stereo, as handed to the audio processor.
+		std::vector<float> input(size * 2);
+		for (auto &s : input)
+			s = sample(rng);
+		std::vector<double> magnitudes(size / 2);
+
+		FFT fft;
+		fft.resize(size);
+		runner.run("fft/" + std::to_string(size), [&] {
+			fft.perform(input.data(), size, 2, magnitudes.data());
+			g_sink = g_sink + static_cast<u64>(magnitudes[1]);
+		});
+	}
+}
+
+static json to_json(std::vector<Bench> const &results)
+{
+	json j;
+	j["segment_kernel"] = CollideCircleSegmentsKernel();
+	j["benchmarks"] = json::array();
+	for (auto const &result : results) {
+		j["benchmarks"].push_back({
+		    { "name", result.name },
+		    { "ns_per_op", result.ns_per_op },
+		    { "ops_per_sample", result.ops_per_sample },
+		});
+	}
+	return j;
+}
+
+// Prints each benchmark against the baseline and returns how many got slower than `threshold`.
+static int compare(std::vector<Bench> const &results, json const &baseline, f64 threshold)
+{
+	std::map<std::string, f64> before;
+	// at() throws on a missing key, where operator[] on a const json would assert.
+	for (auto const &bench : baseline.at("benchmarks"))
+		before[bench.at("name")] = bench.at("ns_per_op");
+
+	int regressions = 0;
+	for (auto const &result : results) {
+		auto const it = before.find(result.name);
+		if (it == before.end()) {
+			std::fprintf(
+			    stderr, "%-48s %14.1f ns      (new)\n", result.name.c_str(), result.ns_per_op);
+			continue;
+		}
+		f64 const change = (result.ns_per_op / it->second - 1) * 100;
+		bool const regressed = change > threshold;
+		std::fprintf(stderr, "%-48s %14.1f ns %+8.1f%%%s\n", result.name.c_str(),
+		    result.ns_per_op, change, regressed ? "  REGRESSION" : "");
+		regressions += regressed;
+	}
+	return regressions;
+}
+
+int main(int argc, char **argv)
+{
+	std::filesystem::path levels_path = "resources/levels";
+	std::filesystem::path out_path, baseline_path;
+	f64                   threshold = DEFAULT_THRESHOLD;
+	Runner                runner;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string_view const arg = argv[i];
+			if (i + 1 >= argc)
+				throw std::invalid_argument(std::string(arg)); // Every option takes a value.
+			if (arg == "--levels")
+				levels_path = argv[++i];
+			else if (arg == "--filter")
+				runner.filter = argv[++i];
+			else if (arg == "--out")
+				out_path = argv[++i];
+			else if (arg == "--compare")
+				baseline_path = argv[++i];
+			else if (arg == "--threshold")
+				threshold = std::stod(argv[++i]);
+			else
+				throw std::invalid_argument(std::string(arg));
+		}
+	} catch (std::exception const &) {
+		std::cerr << "Usage: " << argv[0]
+		          << " [--levels <dir>] [--filter <text>] [--out <file>] [--compare <baseline>]"
+		             " [--threshold <percent>]"
+		          << std::endl;
+		return 1;
+	}
+
+	std::fprintf(stderr, "segment kernel: %s\n", CollideCircleSegmentsKernel());
+	json baseline;
+	try {
+		// Read up front so a bad baseline doesn't waste a whole run.
+		if (!baseline_path.empty()) {
+			std::ifstream f(baseline_path);
+			if (!f)
+				throw std::runtime_error("Failed to open " + baseline_path.string());
+			baseline = json::parse(f);
+		}
+
+		LevelCatalogue catalogue;
+		catalogue.scan(levels_path);
+		for (auto const &entry : catalogue.entries()) {
+			std::ifstream f(entry.path);
+			json          source = json::parse(f);
+			bench_level(runner, Level::deserialize(source), source);
+		}
+		for (auto const scale : STRESS_SCALES) {
+			auto level = LevelGenerator::scaled(scale).generate();
+			level.name = "maze-" + std::to_string(scale) + "x";
+			bench_level(runner, level, level.serialize());
+		}
+		bench_fft(runner);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	auto const results = to_json(runner.results).dump(2);
+	if (out_path.empty()) {
+		std::cout << results << std::endl;
+	} else {
+		std::ofstream f(out_path);
+		f << results << std::endl;
+	}
+
+	if (!baseline_path.empty()) {
+		int regressions;
+		try {
+			regressions = compare(runner.results, baseline, threshold);
+		} catch (std::exception &e) {
+			std::cerr << baseline_path.string() << ": " << e.what() << std::endl;
+			return 1;
+		}
+		if (regressions) {
+			std::fprintf(stderr, "%d benchmarks regressed more than %.1f%%\n", regressions,
+			    threshold);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,32 @@
+#include <filesystem>
+#include <iostream>
+
+#include "Level.h"
+
+// Compiles LevelN.json files into the binary format read by Level::read_from_binary(), each
+// written next to its source with a .lvl extension.
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <level.json>..." << std::endl;
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = 1; i < argc; i++) {
+		std::filesystem::path input = argv[i];
+		auto                  output = input;
+		output.replace_extension(".lvl");
+		try {
+			Level::read_from_file(input).export_to_binary(output);
+			// Reading it back runs the same validation the game does.
+			Level::read_from_binary(output);
+			std::cout << input.string() << " -> " << output.string() << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << input.string() << ": " << e.what() << std::endl;
+			failed++;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "LevelGenerator.h"
+
+// Writes a generated maze for scaling tests, as level JSON or, for a .lvl path, compiled.
+//
+//     LevelGen [--seed <n>] [--scale <factor>] [--walls <n>] [--segments <n>] [--zones <n>]
+//              [--pickups <n>] [--doors <n>] [--name <name>] <output>
+//
+// --scale sets every count to roughly that multiple of a shipped level, the options after it
+// override single counts.
+int main(int argc, char **argv)
+{
+	LevelGenerator        generator;
+	std::string           name;
+	std::filesystem::path output;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string_view const arg = argv[i];
+			bool const             value = i + 1 < argc;
+			if (arg == "--seed" && value)
+				generator.seed = std::stoul(argv[++i]);
+			else if (arg == "--scale" && value && std::stoul(argv[i + 1]))
+				generator = LevelGenerator::scaled(std::stoul(argv[++i]), generator.seed);
+			else if (arg == "--walls" && value)
+				generator.walls = std::stoul(argv[++i]);
+			else if (arg == "--segments" && value)
+				generator.segments_per_wall = std::stoul(argv[++i]);
+			else if (arg == "--zones" && value)
+				generator.zones_per_kind = std::stoul(argv[++i]);
+			else if (arg == "--pickups" && value)
+				generator.pickups = std::stoul(argv[++i]);
+			else if (arg == "--doors" && value)
+				generator.doors = std::stoul(argv[++i]);
+			else if (arg == "--name" && value)
+				name = argv[++i];
+			else if (arg.starts_with('-') || !output.empty())
+				throw std::invalid_argument(std::string(arg)); // Unknown option or a second path.
+			else
+				output = arg;
+		}
+	} catch (std::exception const &) {
+		output.clear();
+	}
+	// Without walls, segments or an end zone, the maze isn't a level anyone could play or bench.
+	if (output.empty() || !generator.walls || !generator.segments_per_wall
+	    || !generator.zones_per_kind) {
+		std::cerr << "Usage: " << argv[0]
+		          << " [--seed <n>] [--scale <factor>] [--walls <n>] [--segments <n>] [--zones <n>]"
+		             " [--pickups <n>] [--doors <n>] [--name <name>] <output>"
+		          << std::endl;
+		return 1;
+	}
+
+	try {
+		auto level = generator.generate();
+		if (!name.empty())
+			level.name = name;
+		if (output.extension() == ".lvl")
+			level.export_to_binary(output);
+		else
+			level.export_to_file(output);
+
+		usize segments = 0;
+		for (auto const &wall : level.walls)
+			segments += wall.point_count - 1;
+		std::cout << output.string() << ": " << level.walls.size() << " walls, " << segments
+		          << " segments, " << level.zones.size() << " zones, " << level.pickups.size()
+		          << " pickups" << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << output.string() << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "LevelCatalogue.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+// Re-simulates replay files without a window or audio device and reports what the game would
+// have shown at the end of each run. Exits non-zero if any replay fails or never completes.
+//
+//     Verify [--levels <dir>] [--threads <n>] <replay or directory>...
+
+struct Result {
+	std::string error; // Empty if the replay ran.
+	std::string level;
+	bool        completed = false;
+	f64         time = 0;
+	int         collected_files = 0, total_files = 0;
+};
+
+// Each level is read once and copied for every run, a run mutates its copy's pickups and doors.
+struct LevelCache {
+	explicit LevelCache(LevelCatalogue const &catalogue)
+	  : catalogue(catalogue)
+	  , once(catalogue.size())
+	  , levels(catalogue.size())
+	{
+	}
+
+	Level const &get(usize index)
+	{
+		std::call_once(
+		    once[index], [&] { levels[index] = Level::load(catalogue.entries()[index].path); });
+		return *levels[index];
+	}
+
+	LevelCatalogue const             &catalogue;
+	std::vector<std::once_flag>       once;
+	std::vector<std::optional<Level>> levels;
+};
+
+static Result verify(std::filesystem::path const &path, LevelCache &cache)
+{
+	Result result;
+	try {
+		auto const replay = Replay::read_from_file(path);
+		auto const &entries = cache.catalogue.entries();
+		if (replay.level >= entries.size() || entries[replay.level].name != replay.level_name)
+			throw std::runtime_error("level " + replay.level_name + " isn't installed");
+		result.level = replay.level_name;
+
+		Level      level = cache.get(replay.level);
+		Simulation sim;
+		sim.start(level, true);
+
+		f64 const dt = 1.0 / replay.sim_rate;
+		for (auto const input : replay.ticks) {
+			sim.tick(dt, input);
+			if (sim.events & Simulation::Completed)
+				break;
+		}
+
+		result.completed = sim.completion_time != 0;
+		result.time = sim.completion_time;
+		result.collected_files = sim.collected_files;
+		result.total_files = sim.total_files;
+	} catch (std::exception &e) {
+		result.error = e.what();
+	}
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	std::filesystem::path              levels_path = "resources/levels";
+	usize                              threads = ThreadPool::default_worker_count() + 1;
+	std::vector<std::filesystem::path> replays;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string_view const arg = argv[i];
+			if (arg == "--levels" && i + 1 < argc) {
+				levels_path = argv[++i];
+			} else if (arg == "--threads" && i + 1 < argc) {
+				threads = std::stoul(argv[++i]);
+				if (!threads)
+					throw std::invalid_argument("--threads"); // Nothing would run the replays.
+			} else if (std::filesystem::is_directory(arg)) {
+				for (auto const &file : std::filesystem::directory_iterator(arg)) {
+					if (file.path().extension() == ".brr")
+						replays.push_back(file.path());
+				}
+			} else {
+				replays.push_back(arg);
+			}
+		}
+	} catch (std::exception const &) {
+		replays.clear();
+	}
+	if (replays.empty()) {
+		std::cerr << "Usage: " << argv[0] << " [--levels <dir>] [--threads <n>] <replay>..."
+		          << std::endl;
+		return 1;
+	}
+
+	LevelCatalogue catalogue;
+	try {
+		catalogue.scan(levels_path);
+	} catch (std::exception &e) {
+		std::cerr << levels_path.string() << ": " << e.what() << std::endl;
+		return 1;
+	}
+	LevelCache cache(catalogue);
+
+	auto const start = std::chrono::steady_clock::now();
+
+	std::vector<std::future<Result>> results;
+	{
+		ThreadPool pool(threads);
+		results.reserve(replays.size());
+		for (auto const &path : replays)
+			results.push_back(pool.submit([&path, &cache] { return verify(path, cache); }));
+		for (auto &result : results)
+			result.wait();
+	}
+
+	auto const elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start);
+
+	usize failed = 0;
+	for (usize i = 0; i < replays.size(); i++) {
+		auto const result = results[i].get();
+		auto const path = replays[i].string();
+		if (!result.error.empty()) {
+			std::printf("%s: error: %s\n", path.c_str(), result.error.c_str());
+			failed++;
+		} else if (!result.completed) {
+			std::printf("%s: incomplete: %s\n", path.c_str(), result.level.c_str());
+			failed++;
+		} else {
+			std::printf("%s: ok: %s %.2f s, %d/%d files\n", path.c_str(), result.level.c_str(),
+			    result.time, result.collected_files, result.total_files);
+		}
+	}
+	std::fprintf(stderr, "%zu replays, %zu failed, %.2f s on %zu threads\n", replays.size(), failed,
+	    elapsed.count(), threads);
+
+	return failed ? 1 : 0;
+}